@@ -0,0 +1,72 @@
+#include "allocTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Each allocation is preceded by a header holding its size. The header is the size of
+// max_align_t so that the returned memory is still suitably aligned.
+static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+static std::atomic<size_t> g_current_bytes{0};
+static std::atomic<size_t> g_peak_bytes{0};
+static std::atomic<size_t> g_allocation_count{0};
+
+namespace alloc_tracker {
+
+size_t current_bytes() {
+    return g_current_bytes.load();
+}
+
+size_t peak_bytes() {
+    return g_peak_bytes.load();
+}
+
+size_t allocation_count() {
+    return g_allocation_count.load();
+}
+
+void reset_peak() {
+    g_peak_bytes.store(g_current_bytes.load());
+}
+
+}  // namespace alloc_tracker
+
+void* operator new(size_t size) {
+    char* block = static_cast<char*>(std::malloc(size + HEADER_SIZE));
+    if (!block)
+        throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = size;
+
+    size_t current = g_current_bytes.fetch_add(size) + size;
+    size_t peak = g_peak_bytes.load();
+    while (current > peak && !g_peak_bytes.compare_exchange_weak(peak, current)) {
+    }
+    g_allocation_count.fetch_add(1);
+
+    return block + HEADER_SIZE;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr)
+        return;
+    char* block = static_cast<char*>(ptr) - HEADER_SIZE;
+    g_current_bytes.fetch_sub(*reinterpret_cast<size_t*>(block));
+    std::free(block);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
@@ -0,0 +1,25 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+// Counts heap usage of the benchmark program by replacing the global operator new and
+// delete (see allocTracker.cpp). Only linked into benchmark programs.
+
+#include <cstddef>
+
+namespace alloc_tracker {
+
+// Bytes currently allocated
+size_t current_bytes();
+
+// Highest value of current_bytes() since last reset_peak()
+size_t peak_bytes();
+
+// Number of allocations since program start
+size_t allocation_count();
+
+// Sets the peak to the current usage, so the peak of the next operation can be measured
+void reset_peak();
+
+}  // namespace alloc_tracker
+
+#endif  // ALLOC_TRACKER_H
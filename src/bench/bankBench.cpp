@@ -0,0 +1,94 @@
+// Compares opening a large bank of patterns and loading a few of them by name, by
+// reading the whole file with ifstream and by memory mapping it with MappedBank.
+// Reports the time to open and peak heap use while opening, and for the mapped bank
+// the time to then look up and load the patterns.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../storage/mappedBank.h"
+#include "../util/fastRandom.h"
+#include "allocTracker.h"
+#include "benchUtil.h"
+
+static constexpr int NUM_PATTERNS = 5000;
+static constexpr int NUM_LOADED = 10;
+static constexpr int ITERATIONS = 50;
+static const char* BANK_PATH = "/tmp/bankBench.bank";
+
+static void build_bank(BankWriter& writer) {
+    fast_srand(1234);
+    for (int p = 0; p < NUM_PATTERNS; ++p) {
+        Pattern pattern;
+        char name[Pattern::MAX_NAME_LENGTH + 1];
+        snprintf(name, sizeof(name), "Pattern %d", p);
+        pattern.set_name(name).set_length(32);
+        for (int s = 0; s < 32; ++s) {
+            if (fast_rand(0, 1) == 0)
+                continue;
+            Step& step = pattern.step(s);
+            step.flags = Step::ACTIVE;
+            step.note = fast_rand(36, 84);
+            step.velocity = fast_rand(40, 127);
+        }
+        writer.add_pattern(pattern);
+    }
+}
+
+static void report(const char* method, double open_ns, size_t peak_bytes) {
+    printf("%-10s %12.1f %14zu\n", method, open_ns / 1000.0, peak_bytes);
+}
+
+template <typename Func>
+static size_t peak_heap(Func&& func) {
+    alloc_tracker::reset_peak();
+    size_t before = alloc_tracker::current_bytes();
+    func();
+    return alloc_tracker::peak_bytes() - before;
+}
+
+int main() {
+    BankWriter writer;
+    build_bank(writer);
+    if (!writer.write(BANK_PATH)) {
+        printf("Could not write %s\n", BANK_PATH);
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    for (int i = 0; i < NUM_LOADED; ++i)
+        names.push_back("Pattern " + std::to_string(i * NUM_PATTERNS / NUM_LOADED));
+
+    printf("Bank of %d patterns, loading %d of them. Averages of %d runs.\n", NUM_PATTERNS,
+           NUM_LOADED, ITERATIONS);
+    printf("%-10s %12s %14s\n", "method", "open usec", "peak heap");
+
+    // Reading the whole file into memory
+    std::vector<uint8_t> contents;
+    auto read_file = [&] {
+        std::ifstream file(BANK_PATH, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+    double open_ns = average_ns(ITERATIONS, read_file);
+    contents = std::vector<uint8_t>();
+    report("ifstream", open_ns, peak_heap(read_file));
+
+    // Mapping the file, and only touching the index and the patterns loaded
+    MappedBank bank;
+    Pattern pattern;
+    open_ns = average_ns(ITERATIONS, [&] { bank.open(BANK_PATH); });
+    double load_ns = average_ns(ITERATIONS, [&] {
+        for (const std::string& name : names)
+            bank.load_pattern(bank.find(name.c_str()), pattern);
+        do_not_optimize(pattern);
+    });
+    bank.close();
+    report("mmap", open_ns, peak_heap([&] { bank.open(BANK_PATH); }));
+    printf("Loading %d patterns from the mapped bank: %.1f usec\n", NUM_LOADED, load_ns / 1000.0);
+
+    remove(BANK_PATH);
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef BENCH_PROJECT_H
+#define BENCH_PROJECT_H
+
+// Builds the project that the benchmarks save and load, the same every run
+
+#include <cstdio>
+
+#include "../concepts/project.h"
+#include "../util/fastRandom.h"
+
+// Fills in all tracks, num_patterns patterns of 32 steps and a scene for each group of
+// Track::MAX_TRACKS patterns
+inline void build_bench_project(Project& project, int num_patterns) {
+    fast_srand(1234);
+    project.name = "Benchmark";
+    for (int t = 0; t < Track::MAX_TRACKS; ++t) {
+        snprintf(project.tracks[t].name, sizeof(project.tracks[t].name), "Track %d", t + 1);
+        project.tracks[t].midi_channel = t;
+    }
+
+    // Patterns with about half of their 32 steps active
+    for (int p = 0; p < num_patterns; ++p) {
+        Pattern pattern;
+        char name[32];
+        snprintf(name, sizeof(name), "Pattern %d", p);
+        pattern.set_name(name).set_length(32);
+        for (int s = 0; s < 32; ++s) {
+            if (fast_rand(0, 1) == 0)
+                continue;
+            Step& step = pattern.step(s);
+            step.flags = Step::ACTIVE;
+            step.note = fast_rand(36, 84);
+            step.velocity = fast_rand(40, 127);
+            step.gate_percent = fast_rand(10, 100);
+        }
+        project.patterns.add(pattern);
+    }
+
+    for (int s = 0; s < num_patterns / Track::MAX_TRACKS; ++s) {
+        Scene scene;
+        for (int t = 0; t < Track::MAX_TRACKS; ++t)
+            scene.pattern_ids[t] = s * Track::MAX_TRACKS + t;
+        scene.length_bars = 4;
+        project.song.add_scene(scene);
+    }
+}
+
+#endif  // BENCH_PROJECT_H
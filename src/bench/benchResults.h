@@ -0,0 +1,79 @@
+#ifndef BENCH_RESULTS_H
+#define BENCH_RESULTS_H
+
+// Collects benchmark results, printing each as it is added, and writes them as JSON
+// in the same format as Google Benchmark's --benchmark_out, so that runs can be
+// compared with its tools/compare.py to track regressions.
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../util/json.hpp"
+#include "benchUtil.h"
+
+class BenchResults {
+   public:
+    // Times func with average_ns() and adds the result. When func does several
+    // operations per call, such as a loop over a batch, ops_per_call makes the result
+    // the time per operation.
+    template <typename Func>
+    double run(const std::string& name, int iterations, Func&& func, int ops_per_call = 1) {
+        double ns = average_ns(iterations, func) / ops_per_call;
+        add(name, iterations * ops_per_call, ns);
+        return ns;
+    }
+
+    void add(const std::string& name, int iterations, double ns_per_iteration) {
+        printf("%-40s %12.1f ns\n", name.c_str(), ns_per_iteration);
+        results.push_back({name, iterations, ns_per_iteration});
+    }
+
+    // Returns false if the file can't be written
+    bool write_json(const std::string& path, const std::string& executable) const {
+        using json = nlohmann::json;
+
+        char date[32];
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+        json benchmarks = json::array();
+        for (const Result& result : results) {
+            benchmarks.push_back({{"name", result.name},
+                                  {"run_name", result.name},
+                                  {"run_type", "iteration"},
+                                  {"iterations", result.iterations},
+                                  {"real_time", result.ns},
+                                  {"cpu_time", result.ns},
+                                  {"time_unit", "ns"}});
+        }
+
+#ifdef NDEBUG
+        const char* build_type = "release";
+#else
+        const char* build_type = "debug";
+#endif
+        json context = {{"date", date},
+                        {"executable", executable},
+                        {"num_cpus", std::thread::hardware_concurrency()},
+                        {"library_build_type", build_type}};
+
+        std::ofstream file(path);
+        file << json{{"context", context}, {"benchmarks", benchmarks}}.dump(2) << '\n';
+        return (bool)file;
+    }
+
+   private:
+    struct Result {
+        std::string name;
+        int iterations;
+        double ns;
+    };
+    std::vector<Result> results;
+};
+
+#endif  // BENCH_RESULTS_H
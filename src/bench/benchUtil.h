@@ -0,0 +1,28 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+// Small helpers shared by the benchmark programs
+
+#include <chrono>
+
+// Runs func the specified number of times and returns the average time per call in
+// nanoseconds. func is run once beforehand to warm up caches.
+template <typename Func>
+double average_ns(int iterations, Func&& func) {
+    func();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        func();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// Keeps the compiler from optimizing away a value that is otherwise unused
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif  // BENCH_UTIL_H
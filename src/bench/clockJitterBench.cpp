@@ -0,0 +1,241 @@
+// Measures how accurately Clock ticks while the machine is busy. Runs a clock for a
+// number of seconds while background threads load the CPU, memory bandwidth and the
+// heap allocator, then reports percentiles of how late the ticks were compared to a
+// perfect clock started at the first tick, and how far the clock drifted. Options
+// select the sleeping strategy and scheduling of the clock thread, so they can be
+// compared:
+//
+//   clockJitterBench --seconds 20 --cpu 8 --memory 2 --alloc 2
+//   clockJitterBench --spin-us 200
+//   sudo clockJitterBench --fifo 80
+//
+// With --json the results are also written in Google Benchmark's JSON format. --help
+// lists the options.
+
+#define LOG_MODULE_NAME "bench"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "../seq/clock.h"
+#include "../util/debug.h"
+#include "../util/fastRandom.h"
+#include "benchResults.h"
+
+struct Options {
+    int bpm = 120;
+    int ppqn = 24;
+    int seconds = 10;
+    int cpu_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int memory_threads = 1;
+    int alloc_threads = 1;
+    int spin_us = 0;
+    // SCHED_FIFO priority of the clock thread, or 0 for the normal scheduler
+    int fifo_priority = 0;
+    const char* json_path = nullptr;
+};
+
+// Size of each of the two buffers copied between by a memory load thread. Much larger
+// than the caches, so the copies use memory bandwidth.
+static constexpr size_t MEMORY_LOAD_BYTES = 32 << 20;
+
+// Number of live allocations kept by an allocation load thread
+static constexpr int ALLOC_LOAD_SLOTS = 1024;
+
+static std::atomic<bool> load_running{true};
+
+// When each tick happened, from log_timestamp(), indexed by PPQN count - 1. Written
+// only by the clock thread, and read once it has stopped.
+static std::vector<uint64_t> tick_times;
+
+static void record_tick(uint32_t count) {
+    if (count - 1 < tick_times.size())
+        tick_times[count - 1] = log_timestamp();
+}
+
+static void cpu_load() {
+    uint64_t x = 1;
+    while (load_running.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 10000; ++i)
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        do_not_optimize(x);
+    }
+}
+
+static void memory_load() {
+    std::vector<char> a(MEMORY_LOAD_BYTES, 1);
+    std::vector<char> b(MEMORY_LOAD_BYTES, 2);
+    while (load_running.load(std::memory_order_relaxed)) {
+        memcpy(b.data(), a.data(), MEMORY_LOAD_BYTES);
+        a.swap(b);
+        do_not_optimize(a[0]);
+    }
+}
+
+static void alloc_load(uint64_t seed) {
+    FastRandom random(seed);
+    std::vector<std::unique_ptr<char[]>> slots(ALLOC_LOAD_SLOTS);
+    while (load_running.load(std::memory_order_relaxed)) {
+        auto& slot = slots[random.below(ALLOC_LOAD_SLOTS)];
+        size_t size = 16 + random.below(64 * 1024);
+        slot.reset(new char[size]);
+        slot[0] = (char)size;
+    }
+}
+
+// Sets the scheduling of the calling thread. Threads it creates inherit it.
+static bool set_fifo_priority(int priority) {
+#ifdef __linux__
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), priority ? SCHED_FIFO : SCHED_OTHER, &param) == 0;
+#else
+    return priority == 0;
+#endif
+}
+
+static void print_usage(const char* program) {
+    Options defaults;
+    printf("Usage: %s [options]\n"
+           "  --bpm N            Tempo of the clock (%d)\n"
+           "  --ppqn N           Ticks per quarter note (%d)\n"
+           "  --seconds N        How long to run the clock (%d)\n"
+           "  --cpu THREADS      Threads loading the CPU (one per core, %d here)\n"
+           "  --memory THREADS   Threads loading memory bandwidth (%d)\n"
+           "  --alloc THREADS    Threads loading the heap allocator (%d)\n"
+           "  --spin-us N        Spin for the last N us before each tick (%d)\n"
+           "  --fifo PRIORITY    Run the clock thread with SCHED_FIFO at PRIORITY\n"
+           "  --json PATH        Also write the results as JSON\n"
+           "  --help             Show this\n",
+           program, defaults.bpm, defaults.ppqn, defaults.seconds, defaults.cpu_threads,
+           defaults.memory_threads, defaults.alloc_threads, defaults.spin_us);
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char* value = argv[++i];
+        if (strcmp(arg, "--bpm") == 0)
+            options.bpm = atoi(value);
+        else if (strcmp(arg, "--ppqn") == 0)
+            options.ppqn = atoi(value);
+        else if (strcmp(arg, "--seconds") == 0)
+            options.seconds = std::max(1, atoi(value));
+        else if (strcmp(arg, "--cpu") == 0)
+            options.cpu_threads = atoi(value);
+        else if (strcmp(arg, "--memory") == 0)
+            options.memory_threads = atoi(value);
+        else if (strcmp(arg, "--alloc") == 0)
+            options.alloc_threads = atoi(value);
+        else if (strcmp(arg, "--spin-us") == 0)
+            options.spin_us = atoi(value);
+        else if (strcmp(arg, "--fifo") == 0)
+            options.fifo_priority = atoi(value);
+        else if (strcmp(arg, "--json") == 0)
+            options.json_path = value;
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Room for the ticks of the run plus the one that is running when it stops
+    double ticks_per_second = options.bpm * options.ppqn / 60.0;
+    tick_times.assign((size_t)(ticks_per_second * options.seconds) + 16, 0);
+
+    if (options.fifo_priority && !set_fifo_priority(options.fifo_priority)) {
+        printf("Could not set SCHED_FIFO priority %d, so using the normal scheduler\n",
+               options.fifo_priority);
+        options.fifo_priority = 0;
+    }
+    Clock& clock = Clock::create();
+    set_fifo_priority(0);
+
+    std::vector<std::thread> load_threads;
+    for (int i = 0; i < options.cpu_threads; ++i)
+        load_threads.emplace_back(cpu_load);
+    for (int i = 0; i < options.memory_threads; ++i)
+        load_threads.emplace_back(memory_load);
+    for (int i = 0; i < options.alloc_threads; ++i)
+        load_threads.emplace_back(alloc_load, i + 1);
+
+    printf("Clock at %d BPM, %d PPQN for %d seconds, spinning %d us, %s scheduler\n",
+           clock.set_BPM(options.bpm).get_BPM(), clock.set_PPQN(options.ppqn).get_PPQN(),
+           options.seconds, options.spin_us, options.fifo_priority ? "SCHED_FIFO" : "normal");
+    printf("Load threads: %d cpu, %d memory, %d alloc\n", options.cpu_threads,
+           options.memory_threads, options.alloc_threads);
+
+    clock.set_spin_time(std::chrono::microseconds(options.spin_us))
+        .add_PPQN_callback(record_tick)
+        .run();
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    clock.stop();
+
+    load_running = false;
+    for (std::thread& thread : load_threads)
+        thread.join();
+
+    size_t ticks = std::min<size_t>(clock.get_PPQN_count(), tick_times.size());
+    if (ticks < 2) {
+        printf("Only %zu ticks\n", ticks);
+        return 1;
+    }
+
+    // Lateness of each tick compared to a perfect clock started at the first tick
+    double period_ns = 60e9 / (clock.get_BPM() * clock.get_PPQN());
+    std::vector<double> lateness(ticks);
+    for (size_t i = 0; i < ticks; ++i)
+        lateness[i] = (double)(tick_times[i] - tick_times[0]) - i * period_ns;
+    double drift_ns = lateness[ticks - 1];
+    double tempo_error_ppm = drift_ns / ((ticks - 1) * period_ns) * 1e6;
+    std::sort(lateness.begin(), lateness.end());
+
+    BenchResults results;
+    printf("%zu ticks, lateness:\n", ticks);
+    for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+        size_t index = std::min(ticks - 1, (size_t)(percentile / 100.0 * ticks));
+        char name[32];
+        snprintf(name, sizeof(name), "lateness p%g", percentile);
+        results.add(name, (int)ticks, lateness[index]);
+    }
+    results.add("lateness max", (int)ticks, lateness[ticks - 1]);
+    results.add("drift", (int)ticks, drift_ns);
+    printf("Tempo error %.1f ppm\n", tempo_error_ppm);
+
+    if (options.json_path && !results.write_json(options.json_path, argv[0])) {
+        printf("Could not write %s\n", options.json_path);
+        return 1;
+    }
+
+    delete &clock;
+    return 0;
+}
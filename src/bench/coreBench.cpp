@@ -0,0 +1,133 @@
+// Benchmarks the hot paths of the sequencer core: random numbers, logging with the
+// level enabled and disabled, computing when the next clock tick is due, dispatching a
+// tick to N callbacks, and saving and loading a project as JSON. Results are printed,
+// and with --json are also written in Google Benchmark's JSON format so that runs can
+// be compared to track regressions:
+//
+//   coreBench --json results.json
+//
+// stderr is redirected to /dev/null so that the cost of the terminal isn't measured.
+
+#define LOG_MODULE_NAME "bench"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../concepts/projectIO.h"
+#include "../concepts/projectSaxLoader.h"
+#include "../seq/clock.h"
+#include "../util/debug.h"
+#include "../util/fastRandom.h"
+#include "benchProject.h"
+#include "benchResults.h"
+
+using json = nlohmann::json;
+
+// Gives access to the parts of Clock that its thread normally runs
+class BenchClock : public Clock {
+   public:
+    using Clock::determine_sleep_time;
+    using Clock::tick;
+};
+
+static uint32_t callback_ticks = 0;
+
+static void count_tick(uint32_t count) {
+    callback_ticks += count;
+}
+
+// Generators are timed in batches, since that is how they are used, and so the
+// generator state can stay in registers
+static constexpr int RANDOM_BATCH = 1000;
+
+template <typename Generate>
+static void run_random(BenchResults& results, const char* name, Generate&& generate) {
+    results.run(
+        name, 10000,
+        [&] {
+            uint32_t sum = 0;
+            for (int i = 0; i < RANDOM_BATCH; ++i)
+                sum += generate();
+            do_not_optimize(sum);
+        },
+        RANDOM_BATCH);
+}
+
+static void bench_random(BenchResults& results) {
+    run_random(results, "fast_rand()", [] { return fast_rand(); });
+    run_random(results, "fast_rand(1, 100)", [] { return fast_rand(1, 100); });
+    run_random(results, "FastRandom::next()", [] { return default_random().next(); });
+}
+
+static void bench_logging(BenchResults& results) {
+    int i = 0;
+    log_set_level("bench", LOG_LEVEL_DEBUG);
+    results.run("debug() enabled", 100000, [&] { debug("Tick %d of %d", ++i, 24); });
+
+    log_set_level("bench", LOG_LEVEL_WARNING);
+    results.run("debug() disabled", 10000000, [&] { debug("Tick %d of %d", ++i, 24); });
+    do_not_optimize(i);
+}
+
+static void bench_clock(BenchResults& results) {
+    BenchClock clock;
+    clock.set_BPM(120).set_PPQN(24);
+    results.run("Clock::determine_sleep_time()", 1000000,
+                [&] { do_not_optimize(clock.determine_sleep_time()); });
+
+    for (int subscribers : {0, 1, 4, 16}) {
+        BenchClock dispatch_clock;
+        dispatch_clock.set_PPQN(24);
+        for (int i = 0; i < subscribers; ++i)
+            dispatch_clock.add_PPQN_callback(count_tick);
+        results.run("Clock::tick() " + std::to_string(subscribers) + " callbacks", 1000000,
+                    [&] { dispatch_clock.tick(); });
+    }
+    do_not_optimize(callback_ticks);
+}
+
+static void bench_project(BenchResults& results) {
+    constexpr int ITERATIONS = 50;
+
+    Project project;
+    build_bench_project(project, 128);
+    Project loaded;
+
+    std::string text;
+    results.run("project save json", ITERATIONS,
+                [&] { text = project_to_json(project).dump(); });
+    results.run("project load json", ITERATIONS,
+                [&] { project_from_json(json::parse(text), loaded); });
+    results.run("project load json sax", ITERATIONS,
+                [&] { project_from_json_text(text.data(), text.size(), loaded); });
+}
+
+int main(int argc, char** argv) {
+    const char* json_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            printf("Usage: %s [--json path]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!freopen("/dev/null", "w", stderr)) {
+        printf("Could not redirect stderr\n");
+        return 1;
+    }
+
+    BenchResults results;
+    bench_random(results);
+    bench_logging(results);
+    bench_clock(results);
+    bench_project(results);
+
+    if (json_path && !results.write_json(json_path, argv[0])) {
+        printf("Could not write %s\n", json_path);
+        return 1;
+    }
+    return 0;
+}
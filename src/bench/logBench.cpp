@@ -0,0 +1,70 @@
+// Measures the cost per call of logging from a hot thread: the synchronous log macros,
+// which format and write to stderr right away, and the asynchronous ones, which only
+// copy the arguments into the thread's ring. stderr is redirected to /dev/null so the
+// terminal doesn't dominate. Also measures recording into the flight recorder, and
+// calls that their module's level disables.
+
+#define LOG_MODULE_NAME "bench"
+
+#include <chrono>
+#include <cstdio>
+
+#include "../util/asyncLog.h"
+#include "../util/debug.h"
+#include "../util/flightRecorder.h"
+#include "benchUtil.h"
+
+// Calls per batch, which fits in a ring so nothing is dropped
+static constexpr int BATCH = 200;
+static constexpr int BATCHES = 500;
+
+// Average ns per call of log_call, excluding the time to write the batches out
+template <typename Func>
+static double ns_per_call(Func&& log_call) {
+    std::chrono::nanoseconds total{0};
+    for (int batch = 0; batch < BATCHES; ++batch) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BATCH; ++i)
+            log_call(i);
+        total += std::chrono::steady_clock::now() - start;
+        async_log_flush();
+    }
+    return (double)total.count() / (BATCH * BATCHES);
+}
+
+int main() {
+    if (!freopen("/dev/null", "w", stderr)) {
+        printf("Could not redirect stderr\n");
+        return 1;
+    }
+    async_log_register_thread();
+    log_set_level("bench", LOG_LEVEL_DEBUG);
+
+    printf("%-28s %8.1f ns per call\n", "log_debug()", ns_per_call([](int i) {
+               log_debug("Calling bpm callbacks for bpm_count=%d ppqn_count=%d", i, i * 24);
+           }));
+
+    printf("%-28s %8.1f ns per call\n", "async_log_debug()", ns_per_call([](int i) {
+               async_log_debug("Calling bpm callbacks for bpm_count=%d ppqn_count=%d", i, i * 24);
+           }));
+
+    printf("%-28s %8.1f ns per call\n", "async_log_debug() string", ns_per_call([](int i) {
+               async_log_debug("Clock %s tick %d", "main", i);
+           }));
+
+    printf("%-28s %8.1f ns per call\n", "flight_record()",
+           ns_per_call([](int i) { flight_record("tick", i); }));
+
+    log_set_level("bench", LOG_LEVEL_WARNING);
+
+    printf("%-28s %8.1f ns per call\n", "log_debug() disabled", ns_per_call([](int i) {
+               log_debug("Calling bpm callbacks for bpm_count=%d ppqn_count=%d", i, i * 24);
+           }));
+
+    printf("%-28s %8.1f ns per call\n", "async_log_debug() disabled", ns_per_call([](int i) {
+               async_log_debug("Calling bpm callbacks for bpm_count=%d ppqn_count=%d", i, i * 24);
+           }));
+
+    printf("Dropped %u\n", async_log_dropped());
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Measures the preset index for a large library: loading the index, and searching it
+// by name prefix and by tags as the browser does while the user types or filters.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../storage/presetIndex.h"
+#include "../util/fastRandom.h"
+#include "benchUtil.h"
+
+static constexpr int NUM_PRESETS = 2000;
+static constexpr int ITERATIONS = 1000;
+static const char* INDEX_PATH = "/tmp/presetBench.index";
+
+static const char* const WORDS[] = {"Acid", "Bass", "Chord", "Drum", "Echo", "Funk",
+                                    "Groove", "House", "Lead", "Pad", "Pluck", "Techno"};
+static const char* const TAGS[] = {"dark", "bright", "fast", "slow", "minor", "major",
+                                   "ambient", "dance"};
+
+static void build_index(PresetIndex& index) {
+    fast_srand(1234);
+    for (int p = 0; p < NUM_PRESETS; ++p) {
+        Pattern pattern;
+        char name[Pattern::MAX_NAME_LENGTH + 1];
+        snprintf(name, sizeof(name), "%s %s %d", WORDS[fast_rand(0, 11)], WORDS[fast_rand(0, 11)],
+                 p);
+        pattern.set_name(name).set_length(16 * fast_rand(1, 4));
+        for (int s = 0; s < pattern.get_length(); ++s) {
+            if (fast_rand(0, 1) == 0)
+                pattern.step(s).flags = Step::ACTIVE;
+        }
+
+        uint32_t tags = index.tag_bit(TAGS[fast_rand(0, 7)]) | index.tag_bit(TAGS[fast_rand(0, 7)]);
+        index.add_pattern(pattern, (Track::Type)fast_rand(0, 2), tags);
+    }
+}
+
+int main() {
+    PresetIndex index;
+    build_index(index);
+    if (!index.save(INDEX_PATH)) {
+        printf("Could not write %s\n", INDEX_PATH);
+        return 1;
+    }
+
+    printf("Index of %d presets. Averages of %d runs.\n", NUM_PRESETS, ITERATIONS);
+
+    PresetIndex loaded;
+    double ns = average_ns(ITERATIONS, [&] { loaded.load(INDEX_PATH); });
+    printf("%-24s %10.2f usec\n", "load", ns / 1000.0);
+
+    std::vector<int> results;
+    const char* prefixes[] = {"b", "ba", "bass", "bass p", "bass pad 1"};
+    for (const char* prefix : prefixes) {
+        ns = average_ns(ITERATIONS, [&] {
+            results.clear();
+            loaded.search(prefix, 0, results);
+        });
+        std::string label = std::string("prefix \"") + prefix + "\"";
+        printf("%-24s %10.2f usec %6zu matches\n", label.c_str(), ns / 1000.0, results.size());
+    }
+
+    uint32_t tags = loaded.find_tag("dark") | loaded.find_tag("fast");
+    ns = average_ns(ITERATIONS, [&] {
+        results.clear();
+        loaded.search("", tags, results);
+    });
+    printf("%-24s %10.2f usec %6zu matches\n", "tags dark+fast", ns / 1000.0, results.size());
+
+    remove(INDEX_PATH);
+    return 0;
+}
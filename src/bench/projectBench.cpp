@@ -0,0 +1,79 @@
+// Compares saving and loading a large project (16 tracks, 128 patterns) as JSON text,
+// both through the json DOM and with the streaming SAX loader, as MessagePack and CBOR
+// via nlohmann, and in the custom binary format. Reports the
+// size of each form along with save and load time and peak heap use during load.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../concepts/projectIO.h"
+#include "../concepts/projectSaxLoader.h"
+#include "allocTracker.h"
+#include "benchProject.h"
+#include "benchUtil.h"
+
+using json = nlohmann::json;
+
+static constexpr int NUM_PATTERNS = 128;
+static constexpr int NUM_SCENES = NUM_PATTERNS / Track::MAX_TRACKS;
+static constexpr int ITERATIONS = 50;
+
+static void report(const char* format, size_t bytes, double save_ns, double load_ns,
+                   size_t load_peak_bytes) {
+    printf("%-12s %10zu %12.1f %12.1f %14zu\n", format, bytes, save_ns / 1000.0,
+           load_ns / 1000.0, load_peak_bytes);
+}
+
+// Peak heap use while loading into an empty project. Includes the loaded project.
+template <typename Func>
+static size_t peak_heap(Project& loaded, Func&& func) {
+    loaded.clear();
+    alloc_tracker::reset_peak();
+    size_t before = alloc_tracker::current_bytes();
+    func();
+    return alloc_tracker::peak_bytes() - before;
+}
+
+int main() {
+    Project project;
+    build_bench_project(project, NUM_PATTERNS);
+    Project loaded;
+
+    printf("Project with %d tracks, %d patterns, %d scenes. Averages of %d runs.\n",
+           Track::MAX_TRACKS, NUM_PATTERNS, NUM_SCENES, ITERATIONS);
+    printf("%-12s %10s %12s %12s %14s\n", "format", "bytes", "save usec", "load usec",
+           "load peak heap");
+
+    // JSON text
+    std::string text;
+    double save_ns = average_ns(ITERATIONS, [&] { text = project_to_json(project).dump(); });
+    auto load_json = [&] { project_from_json(json::parse(text), loaded); };
+    double load_ns = average_ns(ITERATIONS, load_json);
+    report("json", text.size(), save_ns, load_ns, peak_heap(loaded, load_json));
+
+    // JSON text without building the DOM. Saving is the same as above.
+    auto load_sax = [&] { project_from_json_text(text.data(), text.size(), loaded); };
+    load_ns = average_ns(ITERATIONS, load_sax);
+    report("json sax", text.size(), save_ns, load_ns, peak_heap(loaded, load_sax));
+
+    // MessagePack and CBOR still go through the json DOM
+    std::vector<uint8_t> bytes;
+    save_ns = average_ns(ITERATIONS, [&] { bytes = json::to_msgpack(project_to_json(project)); });
+    auto load_msgpack = [&] { project_from_json(json::from_msgpack(bytes), loaded); };
+    load_ns = average_ns(ITERATIONS, load_msgpack);
+    report("msgpack", bytes.size(), save_ns, load_ns, peak_heap(loaded, load_msgpack));
+
+    save_ns = average_ns(ITERATIONS, [&] { bytes = json::to_cbor(project_to_json(project)); });
+    auto load_cbor = [&] { project_from_json(json::from_cbor(bytes), loaded); };
+    load_ns = average_ns(ITERATIONS, load_cbor);
+    report("cbor", bytes.size(), save_ns, load_ns, peak_heap(loaded, load_cbor));
+
+    // Custom binary
+    save_ns = average_ns(ITERATIONS, [&] { project_to_binary(project, bytes); });
+    auto load_binary = [&] { project_from_binary(bytes.data(), bytes.size(), loaded); };
+    load_ns = average_ns(ITERATIONS, load_binary);
+    report("binary", bytes.size(), save_ns, load_ns, peak_heap(loaded, load_binary));
+
+    return 0;
+}
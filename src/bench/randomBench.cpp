@@ -0,0 +1,136 @@
+// Compares the speed of the random number generators: the original global LCG that
+// fast_rand() used to be, FastRandom used directly, and fast_rand() through the
+// thread's default generator. Then compares ways of getting values in a range: the
+// original modulo, Lemire's multiply-shift, and the bulk fill functions. Finally
+// compares filling noise buffers with FastRandom and with the vectorized
+// FastRandomLanes, and measures the stateless StepRandom.
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../util/fastRandom.h"
+#include "benchUtil.h"
+
+static constexpr int COUNT = 1000000;
+static constexpr int ITERATIONS = 20;
+
+// The original fast_rand(), with its 15 bit output. Not inlined, since fast_rand() is
+// in another translation unit.
+static unsigned int lcg_seed = 1234;
+__attribute__((noinline)) static int lcg_rand() {
+    lcg_seed = (214013 * lcg_seed + 2531011);
+    return (lcg_seed >> 16) & 0x7FFF;
+}
+
+static void report(const char* generator, double ns) {
+    printf("%-20s %8.2f ns per value\n", generator, ns / COUNT);
+}
+
+int main() {
+    printf("Generating %d values. Averages of %d runs.\n", COUNT, ITERATIONS);
+
+    report("original LCG", average_ns(ITERATIONS, [] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += lcg_rand();
+               do_not_optimize(sum);
+           }));
+
+    FastRandom generator(1234);
+    report("FastRandom", average_ns(ITERATIONS, [&] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += generator.next();
+               do_not_optimize(sum);
+           }));
+
+    report("default_random()", average_ns(ITERATIONS, [] {
+               FastRandom& thread_generator = default_random();
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += thread_generator.next();
+               do_not_optimize(sum);
+           }));
+
+    fast_srand(1234);
+    report("fast_rand()", average_ns(ITERATIONS, [] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += fast_rand();
+               do_not_optimize(sum);
+           }));
+
+    printf("\nValues from 0 to 99\n");
+
+    report("LCG modulo", average_ns(ITERATIONS, [] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += lcg_rand() % 100;
+               do_not_optimize(sum);
+           }));
+
+    report("range()", average_ns(ITERATIONS, [&] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += generator.range(0, 99);
+               do_not_optimize(sum);
+           }));
+
+    report("fast_rand(min, max)", average_ns(ITERATIONS, [] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += fast_rand(0, 99);
+               do_not_optimize(sum);
+           }));
+
+    std::vector<int32_t> ints(COUNT);
+    report("fill_range()", average_ns(ITERATIONS, [&] {
+               generator.fill_range(ints.data(), ints.size(), 0, 99);
+               do_not_optimize(ints[COUNT - 1]);
+           }));
+
+    std::vector<float> floats(COUNT);
+    report("fill_uniform()", average_ns(ITERATIONS, [&] {
+               generator.fill_uniform(floats.data(), floats.size());
+               do_not_optimize(floats[COUNT - 1]);
+           }));
+
+    printf("\nNoise buffers\n");
+
+    FastRandomLanes lanes(1234);
+    report("lanes fill_uniform()", average_ns(ITERATIONS, [&] {
+               lanes.fill_uniform(floats.data(), floats.size(), -1.0f, 1.0f);
+               do_not_optimize(floats[COUNT - 1]);
+           }));
+
+    std::normal_distribution<float> normal;
+    report("normal_distribution", average_ns(ITERATIONS, [&] {
+               for (float& value : floats)
+                   value = normal(generator);
+               do_not_optimize(floats[COUNT - 1]);
+           }));
+
+    report("fill_gaussian()", average_ns(ITERATIONS, [&] {
+               lanes.fill_gaussian(floats.data(), floats.size());
+               do_not_optimize(floats[COUNT - 1]);
+           }));
+
+    report("fill_pink()", average_ns(ITERATIONS, [&] {
+               lanes.fill_pink(floats.data(), floats.size());
+               do_not_optimize(floats[COUNT - 1]);
+           }));
+
+    printf("\nStateless\n");
+
+    StepRandom step_random(1234, 1);
+    report("StepRandom", average_ns(ITERATIONS, [&] {
+               uint32_t sum = 0;
+               for (int i = 0; i < COUNT; ++i)
+                   sum += step_random.value(i);
+               do_not_optimize(sum);
+           }));
+
+    return 0;
+}
@@ -1 +1,115 @@
+#include "pattern.h"
 
+#include <algorithm>
+#include <cstring>
+
+void Pattern::clear() {
+    std::memset(name, 0, sizeof(name));
+    length = DEFAULT_LENGTH;
+    step_ticks = DEFAULT_STEP_TICKS;
+    std::fill(steps, steps + MAX_STEPS, Step());
+}
+
+Pattern& Pattern::set_name(const char* new_name) {
+    std::memset(name, 0, sizeof(name));
+    std::strncpy(name, new_name, MAX_NAME_LENGTH);
+
+    // So can chain calls
+    return *this;
+}
+
+Pattern& Pattern::set_length(int new_length) {
+    length = std::clamp(new_length, 1, MAX_STEPS);
+    return *this;
+}
+
+Pattern& Pattern::set_step_ticks(int ticks) {
+    step_ticks = std::clamp(ticks, 1, 255);
+    return *this;
+}
+
+int Pattern::active_count() const {
+    return std::count_if(steps, steps + MAX_STEPS, [](const Step& s) { return s.is_active(); });
+}
+
+bool Pattern::operator==(const Pattern& other) const {
+    return std::strncmp(name, other.name, sizeof(name)) == 0 && length == other.length &&
+           step_ticks == other.step_ticks && std::equal(steps, steps + MAX_STEPS, other.steps);
+}
+
+size_t Pattern::serialize(uint8_t* buffer) const {
+    uint8_t* out = buffer;
+    size_t name_length = std::strlen(name);
+
+    *out++ = SERIALIZED_VERSION;
+    *out++ = length;
+    *out++ = step_ticks;
+    *out++ = (uint8_t)name_length;
+    std::memcpy(out, name, name_length);
+    out += name_length;
+
+    // Bit mask of which steps are active, little endian
+    uint64_t active_mask = 0;
+    for (int i = 0; i < MAX_STEPS; ++i) {
+        if (steps[i].is_active())
+            active_mask |= (uint64_t)1 << i;
+    }
+    for (int byte = 0; byte < 8; ++byte)
+        *out++ = (uint8_t)(active_mask >> (8 * byte));
+
+    // Inactive steps keep their values so that they can be re-enabled while editing,
+    // but that isn't worth the space. Only the active steps are stored.
+    for (int i = 0; i < MAX_STEPS; ++i) {
+        const Step& s = steps[i];
+        if (!s.is_active())
+            continue;
+        *out++ = s.flags;
+        *out++ = s.note;
+        *out++ = s.velocity;
+        *out++ = s.gate_percent;
+        *out++ = s.probability;
+        *out++ = (uint8_t)s.offset_ticks;
+    }
+
+    return out - buffer;
+}
+
+bool Pattern::deserialize(const uint8_t* data, size_t size) {
+    clear();
+
+    const uint8_t* end = data + size;
+    if (size < 4 || data[0] != SERIALIZED_VERSION)
+        return false;
+
+    const uint8_t* in = data + 4;
+    if ((size_t)(end - in) < (size_t)data[3] + 8)
+        return false;
+    size_t name_length = std::min<size_t>(data[3], MAX_NAME_LENGTH);
+
+    set_length(data[1]);
+    set_step_ticks(data[2]);
+    std::memcpy(name, in, name_length);
+    in += data[3];
+
+    uint64_t active_mask = 0;
+    for (int byte = 0; byte < 8; ++byte)
+        active_mask |= (uint64_t)*in++ << (8 * byte);
+
+    for (int i = 0; i < MAX_STEPS; ++i) {
+        if (!(active_mask & ((uint64_t)1 << i)))
+            continue;
+        if (end - in < 6) {
+            clear();
+            return false;
+        }
+        Step& s = steps[i];
+        s.flags = *in++ | Step::ACTIVE;
+        s.note = *in++;
+        s.velocity = *in++;
+        s.gate_percent = *in++;
+        s.probability = *in++;
+        s.offset_ticks = (int8_t)*in++;
+    }
+
+    return true;
+}
@@ -0,0 +1,122 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+// A Pattern is a sequence of up to MAX_STEPS steps for a single track. It is a plain
+// fixed size object with no pointers, so it can be copied with memcpy, kept in
+// preallocated slots, and swapped between threads.
+//
+// Patterns also have a compact binary form, which is how patterns that are not
+// currently in use are kept in memory. Only the active steps are stored.
+
+#include <cstddef>
+#include <cstdint>
+
+struct Step {
+    // Values for flags
+    static inline constexpr uint8_t ACTIVE = 0x01;
+    static inline constexpr uint8_t TIE = 0x02;
+    static inline constexpr uint8_t ACCENT = 0x04;
+
+    uint8_t flags = 0;
+    uint8_t note = 60;
+    uint8_t velocity = 100;
+
+    // Length of the note as percentage of the step. Above 100 overlaps the next step.
+    uint8_t gate_percent = 50;
+
+    // Chance that the step plays, 0 to 100
+    uint8_t probability = 100;
+
+    // Micro-timing. Number of PPQN ticks the step is played early (negative) or late.
+    int8_t offset_ticks = 0;
+
+    bool is_active() const {
+        return flags & ACTIVE;
+    }
+
+    bool operator==(const Step& other) const {
+        return flags == other.flags && note == other.note && velocity == other.velocity &&
+               gate_percent == other.gate_percent && probability == other.probability &&
+               offset_ticks == other.offset_ticks;
+    }
+    bool operator!=(const Step& other) const {
+        return !(*this == other);
+    }
+};
+
+class Pattern {
+   public:
+    static inline constexpr int MAX_STEPS = 64;
+    static inline constexpr int DEFAULT_LENGTH = 16;
+    static inline constexpr int MAX_NAME_LENGTH = 15;
+
+    // Step length in PPQN ticks for 16th notes at 24 PPQN
+    static inline constexpr int DEFAULT_STEP_TICKS = 6;
+
+    // Version of the binary form, stored as first byte
+    static inline constexpr uint8_t SERIALIZED_VERSION = 1;
+
+    // Largest size of the binary form: header, name, active step mask, and all steps
+    static inline constexpr size_t MAX_SERIALIZED_SIZE = 4 + MAX_NAME_LENGTH + 8 + MAX_STEPS * 6;
+
+    Pattern() {
+        clear();
+    }
+
+    // Sets the pattern back to the defaults, with no active steps
+    void clear();
+
+    Pattern& set_name(const char* name);
+    const char* get_name() const {
+        return name;
+    }
+
+    // Number of steps that are played, 1 to MAX_STEPS
+    Pattern& set_length(int length);
+    int get_length() const {
+        return length;
+    }
+
+    // Length of each step in PPQN ticks
+    Pattern& set_step_ticks(int ticks);
+    int get_step_ticks() const {
+        return step_ticks;
+    }
+
+    // Number of PPQN ticks for the whole pattern
+    int get_length_ticks() const {
+        return length * step_ticks;
+    }
+
+    // Index must be less than MAX_STEPS
+    Step& step(int index) {
+        return steps[index];
+    }
+    const Step& step(int index) const {
+        return steps[index];
+    }
+
+    // Number of steps that are active
+    int active_count() const;
+
+    bool operator==(const Pattern& other) const;
+    bool operator!=(const Pattern& other) const {
+        return !(*this == other);
+    }
+
+    // Writes the binary form into buffer, which must be at least MAX_SERIALIZED_SIZE
+    // bytes. Returns the number of bytes written.
+    size_t serialize(uint8_t* buffer) const;
+
+    // Reads the binary form. Returns false, leaving the pattern cleared, if the data
+    // is truncated or of an unknown version.
+    bool deserialize(const uint8_t* data, size_t size);
+
+   private:
+    char name[MAX_NAME_LENGTH + 1];
+    uint8_t length;
+    uint8_t step_ticks;
+    Step steps[MAX_STEPS];
+};
+
+#endif  // PATTERN_H
@@ -0,0 +1,85 @@
+#ifndef PATTERN_EDIT_CHANNEL_H
+#define PATTERN_EDIT_CHANNEL_H
+
+// PatternEditChannel lets the UI edit a pattern while the clock thread is playing it.
+// The UI modifies its own copy, which can take any number of touch events, and then
+// publishes it. The clock thread picks up the published pattern at the start of a tick.
+// Neither thread ever waits for the other, and the clock thread never sees a half
+// applied edit.
+//
+// Each published version carries the id of the pattern in the PatternStore, so the
+// clock thread knows which pattern it stands in for. The Song owns the channel that
+// the clock thread reads, see Song::edit_pattern().
+
+#include "../util/tripleBuffer.h"
+#include "pattern.h"
+#include "patternStore.h"
+
+class PatternEditChannel {
+   public:
+    struct Version {
+        // Pattern being edited, or NO_PATTERN if none
+        uint16_t id = PatternStore::NO_PATTERN;
+        Pattern pattern;
+    };
+
+    // UI thread. Starts editing the pattern, and publishes it as it is. Unpublished
+    // edits of the pattern edited before are discarded.
+    void start(uint16_t id, const Pattern& pattern) {
+        edit_id = id;
+        editing = pattern;
+        publish();
+    }
+
+    // UI thread. Stops editing, so that the clock thread goes back to the stored pattern
+    void stop() {
+        edit_id = PatternStore::NO_PATTERN;
+        editing.clear();
+        publish();
+    }
+
+    // UI thread. Id of the pattern being edited, or NO_PATTERN if none.
+    uint16_t get_id() const {
+        return edit_id;
+    }
+
+    // UI thread. The copy of the pattern being edited.
+    Pattern& edit() {
+        return editing;
+    }
+
+    // UI thread. Makes the edits so far available to the clock thread.
+    void publish() {
+        Version& version = buffer.write_buffer();
+        version.id = edit_id;
+        version.pattern = editing;
+        buffer.publish();
+        published = editing;
+    }
+
+    // UI thread. Discards edits that have not been published. The published pattern
+    // can't be taken back from the triple buffer since the clock thread might be using
+    // it, so a copy is kept.
+    void revert() {
+        editing = published;
+    }
+
+    // UI thread. The most recently published pattern.
+    const Pattern& last_published() const {
+        return published;
+    }
+
+    // Clock thread. The most recently published version. Stays unchanged until the next
+    // call, so should be called once at the start of each tick.
+    const Version& current() {
+        return buffer.read();
+    }
+
+   private:
+    uint16_t edit_id = PatternStore::NO_PATTERN;
+    Pattern editing;
+    Pattern published;
+    TripleBuffer<Version> buffer;
+};
+
+#endif  // PATTERN_EDIT_CHANNEL_H
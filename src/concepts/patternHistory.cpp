@@ -0,0 +1,92 @@
+#include "patternHistory.h"
+
+#include <algorithm>
+
+PatternHistory::PatternHistory(const Pattern& initial) {
+    make_version(initial, nullptr, versions[0]);
+    count = 1;
+}
+
+void PatternHistory::make_version(const Pattern& pattern, const Version* base, Version& version) {
+    std::copy(pattern.get_name(), pattern.get_name() + sizeof(version.name), version.name);
+    version.length = (uint8_t)pattern.get_length();
+    version.step_ticks = (uint8_t)pattern.get_step_ticks();
+
+    for (int c = 0; c < NUM_CHUNKS; ++c) {
+        const Step* first = &pattern.step(c * CHUNK_STEPS);
+        if (base && std::equal(first, first + CHUNK_STEPS, base->chunks[c]->begin())) {
+            version.chunks[c] = base->chunks[c];
+        } else {
+            auto chunk = std::make_shared<Chunk>();
+            std::copy(first, first + CHUNK_STEPS, chunk->begin());
+            version.chunks[c] = std::move(chunk);
+        }
+    }
+}
+
+bool PatternHistory::record(const Pattern& edited) {
+    Pattern previous;
+    current(previous);
+    if (edited == previous)
+        return false;
+
+    // Discard the versions that could have been redone
+    for (int i = position + 1; i < count; ++i)
+        version_at(i) = Version();
+    count = position + 1;
+
+    // Drop the oldest version if full
+    if (count == CAPACITY) {
+        version_at(0) = Version();
+        oldest = (oldest + 1) % CAPACITY;
+        --count;
+        --position;
+    }
+
+    make_version(edited, &version_at(position), version_at(position + 1));
+    ++count;
+    ++position;
+    return true;
+}
+
+bool PatternHistory::undo() {
+    if (!can_undo())
+        return false;
+    --position;
+    return true;
+}
+
+bool PatternHistory::redo() {
+    if (!can_redo())
+        return false;
+    ++position;
+    return true;
+}
+
+void PatternHistory::current(Pattern& pattern) const {
+    const Version& version = version_at(position);
+    pattern.set_name(version.name).set_length(version.length).set_step_ticks(version.step_ticks);
+    for (int c = 0; c < NUM_CHUNKS; ++c)
+        std::copy(version.chunks[c]->begin(), version.chunks[c]->end(), &pattern.step(c * CHUNK_STEPS));
+}
+
+size_t PatternHistory::unique_chunk_bytes() const {
+    // Each distinct chunk is counted once. Chunks of the current version are what a
+    // plain copy of the pattern would cost, so they are not counted.
+    const Chunk* seen[CAPACITY * NUM_CHUNKS];
+    int num_seen = 0;
+    const Version& current_version = version_at(position);
+    for (int c = 0; c < NUM_CHUNKS; ++c)
+        seen[num_seen++] = current_version.chunks[c].get();
+
+    size_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        for (const auto& chunk : version_at(i).chunks) {
+            if (std::find(seen, seen + num_seen, chunk.get()) != seen + num_seen)
+                continue;
+            seen[num_seen++] = chunk.get();
+            bytes += sizeof(Chunk);
+        }
+    }
+    return bytes;
+}
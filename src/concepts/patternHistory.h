@@ -0,0 +1,95 @@
+#ifndef PATTERN_HISTORY_H
+#define PATTERN_HISTORY_H
+
+// PatternHistory provides undo/redo for edits of a pattern. Instead of a full copy of the
+// pattern for every edit, each version is a set of shared pointers to immutable chunks
+// of steps. Recording an edit only allocates new chunks for the steps that changed; all
+// other chunks are shared with the previous version. Undo and redo just move a position
+// within a fixed size ring of versions, and the oldest versions are dropped once
+// MAX_DEPTH is reached, which bounds the memory used.
+//
+// Used from the UI thread only. Typical use with a PatternEditChannel:
+//   history.record(channel.edit());  channel.publish();   // after an edit
+//   history.undo();  history.current(channel.edit());  channel.publish();
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "pattern.h"
+
+class PatternHistory {
+   public:
+    static inline constexpr int CHUNK_STEPS = 8;
+    static inline constexpr int NUM_CHUNKS = Pattern::MAX_STEPS / CHUNK_STEPS;
+
+    // Number of edits that can be undone
+    static inline constexpr int MAX_DEPTH = 64;
+
+    explicit PatternHistory(const Pattern& initial);
+
+    // Records the edited pattern as the new current version. Any versions that could
+    // have been redone are discarded. Returns false, and records nothing, if the
+    // pattern is unchanged.
+    bool record(const Pattern& edited);
+
+    bool can_undo() const {
+        return position > 0;
+    }
+
+    bool can_redo() const {
+        return position + 1 < count;
+    }
+
+    // Steps back to the previous version. Returns false if there is nothing to undo.
+    bool undo();
+
+    // Steps forward to the version that was undone. Returns false if nothing to redo.
+    bool redo();
+
+    // Copies the current version into pattern
+    void current(Pattern& pattern) const;
+
+    // Number of versions held, including the current one
+    int size() const {
+        return count;
+    }
+
+    // Bytes used by step chunks that are referenced only by the history, i.e. the cost
+    // of the history beyond a single copy of the pattern. For diagnostics.
+    size_t unique_chunk_bytes() const;
+
+   private:
+    using Chunk = std::array<Step, CHUNK_STEPS>;
+
+    struct Version {
+        // Pattern settings other than steps. Small, so simply copied.
+        char name[Pattern::MAX_NAME_LENGTH + 1];
+        uint8_t length;
+        uint8_t step_ticks;
+        std::shared_ptr<const Chunk> chunks[NUM_CHUNKS];
+    };
+
+    // Ring of versions. One more than MAX_DEPTH since the current version isn't an undo.
+    static inline constexpr int CAPACITY = MAX_DEPTH + 1;
+
+    Version& version_at(int index) {
+        return versions[(oldest + index) % CAPACITY];
+    }
+    const Version& version_at(int index) const {
+        return versions[(oldest + index) % CAPACITY];
+    }
+
+    // Fills in version from pattern, sharing chunks of base that are unchanged
+    static void make_version(const Pattern& pattern, const Version* base, Version& version);
+
+    std::array<Version, CAPACITY> versions;
+    int oldest = 0;
+    int count = 0;
+
+    // Index, relative to oldest, of the current version
+    int position = 0;
+};
+
+#endif  // PATTERN_HISTORY_H
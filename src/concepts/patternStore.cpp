@@ -0,0 +1,214 @@
+#include "patternStore.h"
+
+#include <algorithm>
+
+uint16_t PatternStore::add(const Pattern& pattern) {
+    uint8_t buffer[Pattern::MAX_SERIALIZED_SIZE];
+    size_t size = pattern.serialize(buffer);
+    serialized.emplace_back(buffer, buffer + size);
+    dirty.push_back(true);
+    return (uint16_t)(serialized.size() - 1);
+}
+
+uint16_t PatternStore::add_serialized(const uint8_t* data, size_t size) {
+    serialized.emplace_back(data, data + size);
+    dirty.push_back(false);
+    return (uint16_t)(serialized.size() - 1);
+}
+
+void PatternStore::store_serialized(uint16_t id, const uint8_t* data, size_t size) {
+    if (id == NO_PATTERN)
+        return;
+
+    uint8_t empty[Pattern::MAX_SERIALIZED_SIZE];
+    size_t empty_size = Pattern().serialize(empty);
+    while (serialized.size() <= id)
+        add_serialized(empty, empty_size);
+
+    serialized[id].assign(data, data + size);
+    dirty[id] = false;
+    replace_materialized(id);
+}
+
+void PatternStore::clear() {
+    for (Slot& slot : slots) {
+        slot.pattern_id.store(NO_PATTERN, std::memory_order_release);
+        slot.replaced_id.store(NO_PATTERN, std::memory_order_relaxed);
+    }
+    serialized.clear();
+    dirty.clear();
+}
+
+void PatternStore::store(uint16_t id, const Pattern& pattern) {
+    if (id >= serialized.size())
+        return;
+
+    uint8_t buffer[Pattern::MAX_SERIALIZED_SIZE];
+    size_t size = pattern.serialize(buffer);
+    serialized[id].assign(buffer, buffer + size);
+    dirty[id] = true;
+    replace_materialized(id);
+}
+
+bool PatternStore::load(uint16_t id, Pattern& pattern) const {
+    if (id >= serialized.size())
+        return false;
+
+    const Slot* slot = slot_for(id);
+    if (slot) {
+        pattern = slot->pattern;
+        return true;
+    }
+
+    return pattern.deserialize(serialized[id].data(), serialized[id].size());
+}
+
+const Pattern* PatternStore::find(uint16_t id) const {
+    const Slot* slot = slot_for(id);
+    return slot ? &slot->pattern : nullptr;
+}
+
+const Pattern* PatternStore::materialize(uint16_t id) {
+    if (id >= serialized.size())
+        return nullptr;
+
+    const Slot* slot = slot_for(id);
+    if (slot)
+        return &slot->pattern;
+
+    const Pattern* pattern = materialize_into_free_slot(id);
+
+    // The clock thread may be holding on to a retired version of the pattern
+    if (pattern)
+        replacements.fetch_add(1, std::memory_order_release);
+    return pattern;
+}
+
+const Pattern* PatternStore::materialize_into_free_slot(uint16_t id) {
+    for (Slot& free_slot : slots) {
+        // A retired slot is free once the clock thread no longer has it pinned
+        if (free_slot.pattern_id.load(std::memory_order_relaxed) != NO_PATTERN ||
+            free_slot.pins.load(std::memory_order_acquire) != 0)
+            continue;
+
+        // Fill in the pattern before publishing the id so that find() never returns
+        // a partially deserialized pattern
+        free_slot.pattern.deserialize(serialized[id].data(), serialized[id].size());
+        free_slot.replaced_id.store(NO_PATTERN, std::memory_order_relaxed);
+        free_slot.pattern_id.store(id, std::memory_order_release);
+        return &free_slot.pattern;
+    }
+    return nullptr;
+}
+
+void PatternStore::replace_materialized(uint16_t id) {
+    Slot* old_slot = slot_for(id);
+    if (!old_slot)
+        return;
+
+    // If there is no free slot the pattern is materialized again by a later call to
+    // materialize(), and until then the clock thread keeps playing the old version
+    materialize_into_free_slot(id);
+
+    // Retire the old slot after the new version is published, so that the clock thread
+    // always finds one of them
+    old_slot->replaced_id.store(id, std::memory_order_relaxed);
+    old_slot->pattern_id.store(NO_PATTERN, std::memory_order_release);
+    replacements.fetch_add(1, std::memory_order_release);
+}
+
+const Pattern* PatternStore::pin(uint16_t id) {
+    if (id == NO_PATTERN)
+        return nullptr;
+
+    for (Slot& slot : slots) {
+        if (slot.pattern_id.load(std::memory_order_acquire) != id)
+            continue;
+
+        // Check again once pinned, in case retain_only() evicted it in between
+        slot.pins.fetch_add(1, std::memory_order_seq_cst);
+        if (slot.pattern_id.load(std::memory_order_seq_cst) == id)
+            return &slot.pattern;
+        slot.pins.fetch_sub(1, std::memory_order_release);
+    }
+    return nullptr;
+}
+
+void PatternStore::unpin(const Pattern* pattern) {
+    for (Slot& slot : slots) {
+        if (&slot.pattern == pattern) {
+            slot.pins.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+const Pattern* PatternStore::repin(const Pattern* pattern) {
+    for (Slot& slot : slots) {
+        if (&slot.pattern != pattern)
+            continue;
+
+        // Since it is pinned the slot isn't reused, so its replaced_id stays valid
+        if (slot.pattern_id.load(std::memory_order_acquire) != NO_PATTERN)
+            return pattern;
+        const Pattern* replacement = pin(slot.replaced_id.load(std::memory_order_relaxed));
+        if (!replacement)
+            return pattern;
+        slot.pins.fetch_sub(1, std::memory_order_release);
+        return replacement;
+    }
+    return pattern;
+}
+
+void PatternStore::retain_only(const uint16_t* ids, int count) {
+    for (Slot& slot : slots) {
+        uint16_t id = slot.pattern_id.load(std::memory_order_relaxed);
+        if (id == NO_PATTERN || std::find(ids, ids + count, id) != ids + count)
+            continue;
+        if (slot.pins.load(std::memory_order_acquire) != 0)
+            continue;
+
+        slot.pattern_id.store(NO_PATTERN, std::memory_order_seq_cst);
+
+        // The clock thread may have pinned it just before it was evicted. If so, it
+        // saw the id and is using the pattern, so put it back.
+        if (slot.pins.load(std::memory_order_seq_cst) != 0)
+            slot.pattern_id.store(id, std::memory_order_release);
+    }
+}
+
+void PatternStore::mark_all_dirty() {
+    dirty.assign(serialized.size(), true);
+}
+
+void PatternStore::clear_all_dirty() {
+    dirty.assign(serialized.size(), false);
+}
+
+int PatternStore::materialized_count() const {
+    return std::count_if(std::begin(slots), std::end(slots), [](const Slot& slot) {
+        return slot.pattern_id.load(std::memory_order_relaxed) != NO_PATTERN;
+    });
+}
+
+size_t PatternStore::serialized_bytes() const {
+    size_t total = 0;
+    for (const auto& bytes : serialized)
+        total += bytes.size();
+    return total;
+}
+
+PatternStore::Slot* PatternStore::slot_for(uint16_t id) {
+    return const_cast<Slot*>(static_cast<const PatternStore*>(this)->slot_for(id));
+}
+
+const PatternStore::Slot* PatternStore::slot_for(uint16_t id) const {
+    if (id == NO_PATTERN)
+        return nullptr;
+
+    for (const Slot& slot : slots) {
+        if (slot.pattern_id.load(std::memory_order_acquire) == id)
+            return &slot;
+    }
+    return nullptr;
+}
@@ -0,0 +1,146 @@
+#ifndef PATTERN_STORE_H
+#define PATTERN_STORE_H
+
+// PatternStore holds all of the patterns of a project. Patterns are kept in their compact
+// serialized form and only the ones that are needed, typically those referenced by the
+// playing and upcoming scenes, are materialized into a fixed number of preallocated
+// slots. This keeps large projects from using up the ESP32's internal RAM.
+//
+// Threading: everything except find(), pin(), unpin(), repin() and replacement_count()
+// is to be called from the UI thread. Those don't lock or allocate and can be called
+// from the clock thread, which pins the patterns it is playing so that they can't be
+// evicted from under it. A materialized pattern is never changed in place, since the
+// clock thread may be playing it. Changing it puts the new version in another slot and
+// retires the old one, which stays as it was until the clock thread moves over to the
+// new version with repin().
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "pattern.h"
+#include "track.h"
+
+class PatternStore {
+   public:
+    static inline constexpr uint16_t NO_PATTERN = 0xFFFF;
+
+    // Enough slots for the patterns of the current, queued, and following scenes, and
+    // for changing the playing patterns while the clock thread still holds the old ones
+    static inline constexpr int CACHE_SLOTS = 4 * Track::MAX_TRACKS;
+
+    // Adds pattern to the store. Returns the id of the new pattern.
+    uint16_t add(const Pattern& pattern);
+
+    // Adds a pattern that is already in serialized form, such as when loading a project.
+    // Returns the id of the new pattern. The data isn't validated until the pattern is
+    // materialized or loaded. Unlike the other ways of changing patterns this doesn't
+    // mark the pattern as dirty.
+    uint16_t add_serialized(const uint8_t* data, size_t size);
+
+    // Replaces a pattern with one in serialized form, such as when replaying saved
+    // changes. If id is beyond the end then empty patterns are added to fill the gap.
+    // Doesn't mark the pattern as dirty.
+    void store_serialized(uint16_t id, const uint8_t* data, size_t size);
+
+    // Removes all patterns
+    void clear();
+
+    // Number of patterns in the store
+    int size() const {
+        return (int)serialized.size();
+    }
+
+    // Replaces the contents of a pattern. If materialized then the new version replaces
+    // it in the cache.
+    void store(uint16_t id, const Pattern& pattern);
+
+    // Copies a pattern out of the store whether materialized or not. Returns false if
+    // there is no such pattern.
+    bool load(uint16_t id, Pattern& pattern) const;
+
+    // The serialized form of a pattern, for saving without deserializing
+    const std::vector<uint8_t>& serialized_pattern(uint16_t id) const {
+        return serialized[id];
+    }
+
+    // Returns the materialized pattern, or nullptr if it isn't currently materialized.
+    // Safe to call from the clock thread.
+    const Pattern* find(uint16_t id) const;
+
+    // Materializes the pattern into a free slot if not already. Returns nullptr if
+    // the id is invalid or all slots are in use. Patterns are changed with store().
+    const Pattern* materialize(uint16_t id);
+
+    // Like find(), but also keeps the pattern from being evicted until unpin() is
+    // called for it. A pattern can be pinned more than once.
+    const Pattern* pin(uint16_t id);
+    void unpin(const Pattern* pattern);
+
+    // Clock thread. If the pinned pattern was changed since it was pinned, pins the new
+    // version in its place and returns it. Otherwise, or if the new version isn't
+    // materialized yet, returns the pattern that was passed in.
+    const Pattern* repin(const Pattern* pattern);
+
+    // Incremented whenever a materialized pattern is changed, or materialized, so the
+    // clock thread knows when to call repin()
+    uint32_t replacement_count() const {
+        return replacements.load(std::memory_order_acquire);
+    }
+
+    // Evicts all materialized patterns other than the specified ones and those that are
+    // pinned, freeing their slots
+    void retain_only(const uint16_t* ids, int count);
+
+    // Whether the pattern changed since clear_dirty() was called for it. Used for
+    // incremental saving.
+    bool is_dirty(uint16_t id) const {
+        return dirty[id];
+    }
+
+    void clear_dirty(uint16_t id) {
+        dirty[id] = false;
+    }
+
+    // Marks every pattern as dirty, such as when a full save is needed
+    void mark_all_dirty();
+
+    // Marks every pattern as saved, such as after a full save
+    void clear_all_dirty();
+
+    // Number of patterns currently materialized
+    int materialized_count() const;
+
+    // Total bytes used by the serialized patterns
+    size_t serialized_bytes() const;
+
+   private:
+    struct Slot {
+        // Id of pattern in slot, or NO_PATTERN if free. Atomic since read by find().
+        std::atomic<uint16_t> pattern_id{NO_PATTERN};
+        // Number of times pinned by the clock thread
+        std::atomic<uint8_t> pins{0};
+        // Id of pattern that replaced the one in slot, or NO_PATTERN if not retired
+        std::atomic<uint16_t> replaced_id{NO_PATTERN};
+        Pattern pattern;
+    };
+
+    // Returns slot holding the pattern, or nullptr
+    Slot* slot_for(uint16_t id);
+    const Slot* slot_for(uint16_t id) const;
+
+    // Materializes the pattern into a slot that is neither in use nor pinned by the
+    // clock thread. Returns nullptr if there is none.
+    const Pattern* materialize_into_free_slot(uint16_t id);
+
+    // Puts the new serialized version of a materialized pattern into a free slot, and
+    // retires the slot with the old version
+    void replace_materialized(uint16_t id);
+
+    std::vector<std::vector<uint8_t>> serialized;
+    std::vector<bool> dirty;
+    Slot slots[CACHE_SLOTS];
+    std::atomic<uint32_t> replacements{0};
+};
+
+#endif  // PATTERN_STORE_H
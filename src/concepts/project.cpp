@@ -0,0 +1,29 @@
+#include "project.h"
+
+void Project::clear() {
+    name.clear();
+    bpm = DEFAULT_BPM;
+    ppqn = DEFAULT_PPQN;
+    for (Track& track : tracks)
+        track = Track();
+    song.clear();
+    song.set_beats_per_bar(4);
+    patterns.clear();
+    settings_dirty = false;
+    dirty_tracks = 0;
+    song_dirty = false;
+}
+
+void Project::mark_all_dirty() {
+    settings_dirty = true;
+    dirty_tracks = (1u << Track::MAX_TRACKS) - 1;
+    song_dirty = true;
+    patterns.mark_all_dirty();
+}
+
+void Project::clear_dirty() {
+    settings_dirty = false;
+    dirty_tracks = 0;
+    song_dirty = false;
+    patterns.clear_all_dirty();
+}
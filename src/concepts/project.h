@@ -0,0 +1,53 @@
+#ifndef PROJECT_H
+#define PROJECT_H
+
+// A Project is everything that gets saved: the settings, the tracks, all of the
+// patterns, and the song that arranges them.
+
+#include <string>
+
+#include "patternStore.h"
+#include "song.h"
+#include "track.h"
+
+class Project {
+   public:
+    static inline constexpr int DEFAULT_BPM = 120;
+    static inline constexpr int DEFAULT_PPQN = 24;
+
+    Project() : song(patterns) {}
+
+    // The song refers to the pattern store, so a project can't simply be copied
+    Project(const Project&) = delete;
+    Project& operator=(const Project&) = delete;
+
+    // Resets to an empty project
+    void clear();
+
+    // Marks everything, including all patterns, as changed
+    void mark_all_dirty();
+
+    // Marks everything, including all patterns, as saved
+    void clear_dirty();
+
+    void mark_track_dirty(int track) {
+        dirty_tracks |= 1u << track;
+    }
+
+    std::string name;
+    int bpm = DEFAULT_BPM;
+    int ppqn = DEFAULT_PPQN;
+    Track tracks[Track::MAX_TRACKS];
+    PatternStore patterns;
+    Song song;
+
+    // What changed since last saved, for incremental saving. Set by whatever edits the
+    // project. Patterns keep track of their own changes in the PatternStore. Saving
+    // clears the flags, so a project is saved either by Autosave or by
+    // save_project_changes(), never both, or each would miss what the other saved.
+    bool settings_dirty = false;
+    uint32_t dirty_tracks = 0;
+    bool song_dirty = false;
+};
+
+#endif  // PROJECT_H
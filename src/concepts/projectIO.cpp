@@ -0,0 +1,389 @@
+#include "projectIO.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#define LOG_MODULE_NAME "project"
+#include "../util/debug.h"
+
+using json = nlohmann::json;
+
+static const char* TRACK_TYPE_NAMES[] = {"note", "drum", "modulation"};
+static const char* FOLLOW_ACTION_NAMES[] = {"loop", "next", "previous", "first",
+                                            "random", "jump", "stop"};
+
+const char* track_type_name(Track::Type type) {
+    return type <= Track::MODULATION ? TRACK_TYPE_NAMES[type] : TRACK_TYPE_NAMES[0];
+}
+
+Track::Type track_type_from_name(const std::string& name) {
+    for (int i = 0; i <= Track::MODULATION; ++i) {
+        if (name == TRACK_TYPE_NAMES[i])
+            return (Track::Type)i;
+    }
+    return Track::NOTE;
+}
+
+const char* follow_action_name(Scene::FollowAction action) {
+    return action <= Scene::STOP ? FOLLOW_ACTION_NAMES[action] : FOLLOW_ACTION_NAMES[0];
+}
+
+Scene::FollowAction follow_action_from_name(const std::string& name) {
+    for (int i = 0; i <= Scene::STOP; ++i) {
+        if (name == FOLLOW_ACTION_NAMES[i])
+            return (Scene::FollowAction)i;
+    }
+    return Scene::NEXT;
+}
+
+// JSON form
+
+// Integers are range checked when loading rather than truncated to fit their field
+struct OutOfRange : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+static int ranged(const json& value, const char* key, int min, int max) {
+    // Fractions are dropped, as when reading an integer
+    double number = std::trunc(value.get<double>());
+    if (!(number >= min && number <= max))
+        throw OutOfRange(std::string(key) + " out of range: " + value.dump());
+    return (int)number;
+}
+
+static int ranged(const json& data, const char* key, int default_value, int min, int max) {
+    auto found = data.find(key);
+    return found == data.end() ? default_value : ranged(*found, key, min, max);
+}
+
+static json pattern_to_json(const Pattern& pattern) {
+    json steps = json::array();
+    for (int i = 0; i < Pattern::MAX_STEPS; ++i) {
+        const Step& step = pattern.step(i);
+        if (!step.is_active())
+            continue;
+        steps.push_back({{"index", i},
+                         {"flags", step.flags},
+                         {"note", step.note},
+                         {"velocity", step.velocity},
+                         {"gate", step.gate_percent},
+                         {"probability", step.probability},
+                         {"offset", step.offset_ticks}});
+    }
+
+    return {{"name", pattern.get_name()},
+            {"length", pattern.get_length()},
+            {"step_ticks", pattern.get_step_ticks()},
+            {"steps", std::move(steps)}};
+}
+
+static void pattern_from_json(const json& data, Pattern& pattern) {
+    pattern.clear();
+    pattern.set_name(data.value("name", "").c_str());
+    pattern.set_length(ranged(data, "length", Pattern::DEFAULT_LENGTH, 1, Pattern::MAX_STEPS));
+    pattern.set_step_ticks(ranged(data, "step_ticks", Pattern::DEFAULT_STEP_TICKS, 1, UINT8_MAX));
+
+    for (const json& step_data : data.at("steps")) {
+        int index = step_data.at("index").get<int>();
+        if (index < 0 || index >= Pattern::MAX_STEPS)
+            continue;
+        Step& step = pattern.step(index);
+        step.flags = ranged(step_data, "flags", Step::ACTIVE, 0, UINT8_MAX) | Step::ACTIVE;
+        step.note = ranged(step_data.at("note"), "note", 0, 127);
+        step.velocity = ranged(step_data, "velocity", step.velocity, 0, 127);
+        step.gate_percent = ranged(step_data, "gate", step.gate_percent, 0, UINT8_MAX);
+        step.probability = ranged(step_data, "probability", step.probability, 0, 100);
+        step.offset_ticks = ranged(step_data, "offset", step.offset_ticks, INT8_MIN, INT8_MAX);
+    }
+}
+
+json project_to_json(const Project& project) {
+    json tracks = json::array();
+    for (const Track& track : project.tracks) {
+        tracks.push_back({{"name", track.name},
+                          {"type", track_type_name(track.type)},
+                          {"channel", track.midi_channel},
+                          {"muted", track.muted}});
+    }
+
+    json patterns = json::array();
+    Pattern pattern;
+    for (int id = 0; id < project.patterns.size(); ++id) {
+        project.patterns.load(id, pattern);
+        patterns.push_back(pattern_to_json(pattern));
+    }
+
+    json scenes = json::array();
+    for (int i = 0; i < project.song.num_scenes(); ++i) {
+        const Scene& scene = project.song.scene(i);
+        json pattern_ids = json::array();
+        for (uint16_t id : scene.pattern_ids) {
+            if (id == PatternStore::NO_PATTERN)
+                pattern_ids.push_back(nullptr);
+            else
+                pattern_ids.push_back(id);
+        }
+        scenes.push_back({{"patterns", std::move(pattern_ids)},
+                          {"length_bars", scene.length_bars},
+                          {"repeats", scene.repeats},
+                          {"follow", follow_action_name(scene.follow_action)},
+                          {"jump_target", scene.jump_target}});
+    }
+
+    return {{"version", PROJECT_JSON_VERSION},
+            {"name", project.name},
+            {"bpm", project.bpm},
+            {"ppqn", project.ppqn},
+            {"beats_per_bar", project.song.get_beats_per_bar()},
+            {"tracks", std::move(tracks)},
+            {"patterns", std::move(patterns)},
+            {"scenes", std::move(scenes)}};
+}
+
+bool project_from_json(const json& data, Project& project) {
+    project.clear();
+    try {
+        if (data.at("version").get<int>() > PROJECT_JSON_VERSION) {
+            log_warning("Project JSON version %d is newer than supported", data["version"].get<int>());
+            return false;
+        }
+
+        project.name = data.value("name", "");
+        project.bpm = ranged(data, "bpm", Project::DEFAULT_BPM, 1, UINT16_MAX);
+        project.ppqn = ranged(data, "ppqn", Project::DEFAULT_PPQN, 1, UINT16_MAX);
+        project.song.set_beats_per_bar(ranged(data, "beats_per_bar", 4, 1, UINT8_MAX));
+
+        int track_index = 0;
+        for (const json& track_data : data.at("tracks")) {
+            if (track_index == Track::MAX_TRACKS)
+                break;
+            Track& track = project.tracks[track_index++];
+            std::strncpy(track.name, track_data.value("name", "").c_str(), Track::MAX_NAME_LENGTH);
+            track.type = track_type_from_name(track_data.value("type", "note"));
+            track.midi_channel = ranged(track_data, "channel", 0, 0, 15);
+            track.muted = track_data.value("muted", false);
+        }
+
+        // Added in serialized form, as when loading the binary form, so that the
+        // patterns aren't marked as changed
+        Pattern pattern;
+        uint8_t buffer[Pattern::MAX_SERIALIZED_SIZE];
+        for (const json& pattern_data : data.at("patterns")) {
+            pattern_from_json(pattern_data, pattern);
+            project.patterns.add_serialized(buffer, pattern.serialize(buffer));
+        }
+
+        for (const json& scene_data : data.at("scenes")) {
+            Scene scene;
+            int track = 0;
+            for (const json& id : scene_data.at("patterns")) {
+                if (track == Track::MAX_TRACKS)
+                    break;
+                uint16_t pattern_id = id.is_null() ? PatternStore::NO_PATTERN
+                                                   : ranged(id, "pattern id", 0, UINT16_MAX);
+                if (pattern_id >= project.patterns.size())
+                    pattern_id = PatternStore::NO_PATTERN;
+                scene.pattern_ids[track++] = pattern_id;
+            }
+            scene.length_bars = ranged(scene_data, "length_bars", 1, 0, UINT8_MAX);
+            scene.repeats = ranged(scene_data, "repeats", 1, 0, UINT8_MAX);
+            scene.follow_action = follow_action_from_name(scene_data.value("follow", "next"));
+            scene.jump_target = ranged(scene_data, "jump_target", 0, 0, UINT16_MAX);
+            project.song.add_scene(scene);
+        }
+    } catch (json::exception& e) {
+        log_warning("Invalid project JSON: %s", e.what());
+        project.clear();
+        return false;
+    } catch (OutOfRange& e) {
+        log_warning("Invalid project JSON: %s", e.what());
+        project.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool save_project_json(const Project& project, const std::string& path) {
+    std::ofstream file(path);
+    file << project_to_json(project).dump(2);
+    return file.good();
+}
+
+bool load_project_json(const std::string& path, Project& project) {
+    std::ifstream file(path);
+    try {
+        return project_from_json(json::parse(file), project);
+    } catch (json::parse_error& e) {
+        log_warning("JSON parse error for %s: %s", path.c_str(), e.what());
+        project.clear();
+        return false;
+    }
+}
+
+// Binary form
+
+void write_project_settings(ByteWriter& out, const Project& project) {
+    out.str(project.name.c_str());
+    out.u16((uint16_t)project.bpm);
+    out.u16((uint16_t)project.ppqn);
+    out.u8((uint8_t)project.song.get_beats_per_bar());
+}
+
+void read_project_settings(ByteReader& in, Project& project) {
+    project.name = in.str();
+    project.bpm = in.u16();
+    project.ppqn = in.u16();
+    project.song.set_beats_per_bar(in.u8());
+}
+
+void write_track(ByteWriter& out, const Track& track) {
+    out.str(track.name);
+    out.u8(track.type);
+    out.u8(track.midi_channel);
+    out.u8(track.muted);
+}
+
+void read_track(ByteReader& in, Track& track) {
+    in.str(track.name, sizeof(track.name));
+    track.type = (Track::Type)std::min<uint8_t>(in.u8(), Track::MODULATION);
+    track.midi_channel = in.u8() & 0x0F;
+    track.muted = in.u8();
+}
+
+void write_scenes(ByteWriter& out, const Song& song) {
+    write_scenes(out, song, 0, song.num_scenes());
+}
+
+void write_scenes(ByteWriter& out, const Song& song, int first, int count) {
+    int end = std::min(first + count, song.num_scenes());
+    out.u16((uint16_t)std::max(end - first, 0));
+    for (int i = first; i < end; ++i) {
+        const Scene& scene = song.scene(i);
+        for (uint16_t id : scene.pattern_ids)
+            out.u16(id);
+        out.u8(scene.length_bars);
+        out.u8(scene.repeats);
+        out.u8(scene.follow_action);
+        out.u16(scene.jump_target);
+    }
+}
+
+void read_scenes(ByteReader& in, Song& song, uint8_t version) {
+    song.clear();
+    append_scenes(in, song, version);
+}
+
+void append_scenes(ByteReader& in, Song& song, uint8_t version) {
+    int num_scenes = in.u16();
+    for (int i = 0; i < num_scenes && in.ok(); ++i) {
+        Scene scene;
+        for (uint16_t& id : scene.pattern_ids)
+            id = in.u16();
+        scene.length_bars = in.u8();
+        scene.repeats = in.u8();
+        scene.follow_action = (Scene::FollowAction)std::min<uint8_t>(in.u8(), Scene::STOP);
+        scene.jump_target = version >= 2 ? in.u16() : in.u8();
+        if (in.ok())
+            song.add_scene(scene);
+    }
+}
+
+void remove_invalid_pattern_ids(Project& project) {
+    for (int i = 0; i < project.song.num_scenes(); ++i) {
+        for (uint16_t& id : project.song.scene(i).pattern_ids) {
+            if (id >= project.patterns.size())
+                id = PatternStore::NO_PATTERN;
+        }
+    }
+}
+
+void project_to_binary(const Project& project, std::vector<uint8_t>& output) {
+    output.clear();
+    ByteWriter out(output);
+    out.raw(PROJECT_BINARY_MAGIC, sizeof(PROJECT_BINARY_MAGIC));
+    out.u8(PROJECT_BINARY_VERSION);
+
+    write_project_settings(out, project);
+
+    out.u8(Track::MAX_TRACKS);
+    for (const Track& track : project.tracks)
+        write_track(out, track);
+
+    out.u16((uint16_t)project.patterns.size());
+    for (int id = 0; id < project.patterns.size(); ++id) {
+        const std::vector<uint8_t>& bytes = project.patterns.serialized_pattern(id);
+        out.block(bytes.data(), bytes.size());
+    }
+
+    write_scenes(out, project.song);
+}
+
+bool project_from_binary(const uint8_t* data, size_t size, Project& project) {
+    project.clear();
+
+    ByteReader in(data, size);
+    const uint8_t* magic = in.raw(sizeof(PROJECT_BINARY_MAGIC));
+    if (!magic || std::memcmp(magic, PROJECT_BINARY_MAGIC, sizeof(PROJECT_BINARY_MAGIC)) != 0) {
+        log_warning("Not a binary project");
+        return false;
+    }
+    uint8_t version = in.u8();
+    if (version > PROJECT_BINARY_VERSION) {
+        log_warning("Binary project version %d is newer than supported", version);
+        return false;
+    }
+
+    read_project_settings(in, project);
+
+    int num_tracks = in.u8();
+    for (int i = 0; i < num_tracks; ++i) {
+        Track track;
+        read_track(in, track);
+        if (i < Track::MAX_TRACKS)
+            project.tracks[i] = track;
+    }
+
+    int num_patterns = in.u16();
+    for (int id = 0; id < num_patterns && in.ok(); ++id) {
+        size_t pattern_size;
+        const uint8_t* pattern_data = in.block(pattern_size);
+        if (pattern_data)
+            project.patterns.add_serialized(pattern_data, pattern_size);
+    }
+
+    read_scenes(in, project.song, version);
+    remove_invalid_pattern_ids(project);
+
+    if (!in.ok()) {
+        log_warning("Binary project is truncated");
+        project.clear();
+        return false;
+    }
+    return true;
+}
+
+bool save_project_binary(const Project& project, const std::string& path) {
+    std::vector<uint8_t> bytes;
+    project_to_binary(project, bytes);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)bytes.data(), bytes.size());
+    return file.good();
+}
+
+bool load_project_binary(const std::string& path, Project& project) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        log_warning("Could not open %s", path.c_str());
+        project.clear();
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+    return project_from_binary(bytes.data(), bytes.size(), project);
+}
@@ -0,0 +1,65 @@
+#ifndef PROJECT_IO_H
+#define PROJECT_IO_H
+
+// Saving and loading of projects. There are two formats:
+//  - JSON, via util/json.hpp, for human readable export and import
+//  - A compact versioned binary layout for on-device storage. Patterns are copied
+//    straight from their serialized form in the PatternStore, so saving and loading
+//    don't need to materialize any patterns.
+//
+// The load functions return false if the data can't be parsed, in which case the
+// project is left cleared.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../util/byteBuffer.h"
+#include "../util/json.hpp"
+#include "project.h"
+
+// Identifies the binary format, and its version. Version 2 widened the scene jump target
+// to 16 bits.
+inline constexpr char PROJECT_BINARY_MAGIC[4] = {'M', 'O', 'D', 'P'};
+inline constexpr uint8_t PROJECT_BINARY_VERSION = 2;
+
+// Version stored in the JSON form
+inline constexpr int PROJECT_JSON_VERSION = 1;
+
+nlohmann::json project_to_json(const Project& project);
+bool project_from_json(const nlohmann::json& data, Project& project);
+
+bool save_project_json(const Project& project, const std::string& path);
+bool load_project_json(const std::string& path, Project& project);
+
+void project_to_binary(const Project& project, std::vector<uint8_t>& output);
+bool project_from_binary(const uint8_t* data, size_t size, Project& project);
+
+bool save_project_binary(const Project& project, const std::string& path);
+bool load_project_binary(const std::string& path, Project& project);
+
+// Pieces of the binary form, so that parts of a project can be saved separately. Scenes
+// are read according to the version of the binary form they were written with.
+void write_project_settings(ByteWriter& out, const Project& project);
+void read_project_settings(ByteReader& in, Project& project);
+void write_track(ByteWriter& out, const Track& track);
+void read_track(ByteReader& in, Track& track);
+void write_scenes(ByteWriter& out, const Song& song);
+void read_scenes(ByteReader& in, Song& song, uint8_t version = PROJECT_BINARY_VERSION);
+
+// Up to count scenes starting at first, and reading them onto the end of the song, so
+// that a long song can be saved in pieces
+void write_scenes(ByteWriter& out, const Song& song, int first, int count);
+void append_scenes(ByteReader& in, Song& song, uint8_t version = PROJECT_BINARY_VERSION);
+
+// Scenes are read before or independently of the patterns they refer to. Once all
+// patterns are loaded this replaces references to missing patterns with NO_PATTERN.
+void remove_invalid_pattern_ids(Project& project);
+
+// Conversions between enums and the strings used in the JSON form
+const char* track_type_name(Track::Type type);
+Track::Type track_type_from_name(const std::string& name);
+const char* follow_action_name(Scene::FollowAction action);
+Scene::FollowAction follow_action_from_name(const std::string& name);
+
+#endif  // PROJECT_IO_H
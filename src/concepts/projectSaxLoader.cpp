@@ -0,0 +1,363 @@
+#include "projectSaxLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#define LOG_MODULE_NAME "project"
+#include "../util/debug.h"
+#include "../util/json.hpp"
+#include "projectIO.h"
+
+using json = nlohmann::json;
+
+// Receives the SAX events and fills in the project. Keeps a small stack of what kind
+// of JSON container is currently being parsed. Objects whose keys can come in any
+// order (tracks, patterns, steps, scenes) are filled into a temporary and added to
+// the project when the object ends.
+class ProjectSaxHandler : public nlohmann::json_sax<json> {
+   public:
+    ProjectSaxHandler(Project& loaded_project) : project(loaded_project) {}
+
+    bool null() override {
+        if (top() == SCENE_PATTERNS)
+            add_scene_pattern(PatternStore::NO_PATTERN);
+        return true;
+    }
+
+    bool boolean(bool value) override {
+        if (top() == TRACK && current_key == "muted")
+            track.muted = value;
+        return true;
+    }
+
+    bool number_integer(number_integer_t value) override {
+        return number(value);
+    }
+
+    bool number_unsigned(number_unsigned_t value) override {
+        return number((int64_t)value);
+    }
+
+    bool number_float(number_float_t value, const string_t&) override {
+        return number((int64_t)value);
+    }
+
+    bool string(string_t& value) override {
+        switch (top()) {
+            case ROOT:
+                if (current_key == "name")
+                    project.name = value;
+                break;
+            case TRACK:
+                if (current_key == "name")
+                    std::strncpy(track.name, value.c_str(), Track::MAX_NAME_LENGTH);
+                else if (current_key == "type")
+                    track.type = track_type_from_name(value);
+                break;
+            case PATTERN:
+                if (current_key == "name")
+                    pattern.set_name(value.c_str());
+                break;
+            case SCENE:
+                if (current_key == "follow")
+                    scene.follow_action = follow_action_from_name(value);
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    bool binary(binary_t&) override {
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        Context context = SKIP;
+        switch (top()) {
+            case NONE:
+                context = ROOT;
+                have_root = true;
+                break;
+            case TRACKS:
+                context = TRACK;
+                track = Track();
+                break;
+            case PATTERNS:
+                context = PATTERN;
+                pattern.clear();
+                break;
+            case STEPS:
+                context = STEP;
+                step = Step();
+                step_index = -1;
+                break;
+            case SCENES:
+                context = SCENE;
+                scene = Scene();
+                scene_track = 0;
+                have_scene_patterns = false;
+                break;
+            default:
+                break;
+        }
+        return push(context);
+    }
+
+    bool key(string_t& value) override {
+        current_key = value;
+        return true;
+    }
+
+    bool end_object() override {
+        switch (top()) {
+            case TRACK:
+                if (num_tracks < Track::MAX_TRACKS)
+                    project.tracks[num_tracks++] = track;
+                break;
+            case PATTERN: {
+                // Added in serialized form, as when loading the binary form, so that the
+                // patterns aren't marked as changed
+                uint8_t buffer[Pattern::MAX_SERIALIZED_SIZE];
+                project.patterns.add_serialized(buffer, pattern.serialize(buffer));
+                break;
+            }
+            case STEP:
+                if (step_index >= 0 && step_index < Pattern::MAX_STEPS) {
+                    step.flags |= Step::ACTIVE;
+                    pattern.step(step_index) = step;
+                }
+                break;
+            case SCENE:
+                if (!have_scene_patterns) {
+                    log_warning("Project JSON scene has no patterns");
+                    return false;
+                }
+                project.song.add_scene(scene);
+                break;
+            default:
+                break;
+        }
+        return pop();
+    }
+
+    bool start_array(std::size_t) override {
+        Context context = SKIP;
+        if (top() == ROOT && current_key == "tracks")
+            context = TRACKS;
+        else if (top() == ROOT && current_key == "patterns")
+            context = PATTERNS;
+        else if (top() == ROOT && current_key == "scenes")
+            context = SCENES;
+        else if (top() == PATTERN && current_key == "steps")
+            context = STEPS;
+        else if (top() == SCENE && current_key == "patterns")
+            context = SCENE_PATTERNS;
+
+        if (context == TRACKS || context == PATTERNS || context == SCENES)
+            have_lists |= 1 << context;
+        else if (context == SCENE_PATTERNS)
+            have_scene_patterns = true;
+        return push(context);
+    }
+
+    bool end_array() override {
+        return pop();
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        log_warning("JSON parse error: %s", e.what());
+        return false;
+    }
+
+    // Whether the whole document had what project_from_json() requires: an object with
+    // a version, and lists of tracks, patterns and scenes
+    bool is_complete() const {
+        if (!have_root) {
+            log_warning("Project JSON is not an object");
+            return false;
+        }
+        if (!have_version) {
+            log_warning("Project JSON has no version");
+            return false;
+        }
+        if (have_lists != ((1 << TRACKS) | (1 << PATTERNS) | (1 << SCENES))) {
+            log_warning("Project JSON is missing tracks, patterns or scenes");
+            return false;
+        }
+        return true;
+    }
+
+   private:
+    enum Context { NONE, ROOT, TRACKS, TRACK, PATTERNS, PATTERN, STEPS, STEP,
+                   SCENES, SCENE, SCENE_PATTERNS, SKIP };
+
+    static inline constexpr int MAX_DEPTH = 16;
+
+    Context top() const {
+        return depth > 0 ? stack[depth - 1] : NONE;
+    }
+
+    bool push(Context context) {
+        // Anything inside of a skipped container is skipped too
+        if (top() == SKIP)
+            context = SKIP;
+        if (depth == MAX_DEPTH) {
+            log_warning("Project JSON nested too deeply");
+            return false;
+        }
+        stack[depth++] = context;
+        return true;
+    }
+
+    bool pop() {
+        --depth;
+        return true;
+    }
+
+    // Integers are range checked rather than truncated to fit their field
+    template <typename Field>
+    bool set(Field& field, int64_t value, int min, int max) {
+        if (value < min || value > max) {
+            log_warning("Invalid project JSON: %s out of range: %lld", current_key.c_str(),
+                        (long long)value);
+            return false;
+        }
+        field = (Field)value;
+        return true;
+    }
+
+    bool number(int64_t value) {
+        int setting = 0;
+        switch (top()) {
+            case ROOT:
+                if (current_key == "version") {
+                    if (value > PROJECT_JSON_VERSION) {
+                        log_warning("Project JSON version %d is newer than supported",
+                                    (int)value);
+                        return false;
+                    }
+                    have_version = true;
+                } else if (current_key == "bpm") {
+                    return set(project.bpm, value, 1, UINT16_MAX);
+                } else if (current_key == "ppqn") {
+                    return set(project.ppqn, value, 1, UINT16_MAX);
+                } else if (current_key == "beats_per_bar") {
+                    if (!set(setting, value, 1, UINT8_MAX))
+                        return false;
+                    project.song.set_beats_per_bar(setting);
+                }
+                break;
+            case TRACK:
+                if (current_key == "channel")
+                    return set(track.midi_channel, value, 0, 15);
+                break;
+            case PATTERN:
+                if (current_key == "length") {
+                    if (!set(setting, value, 1, Pattern::MAX_STEPS))
+                        return false;
+                    pattern.set_length(setting);
+                } else if (current_key == "step_ticks") {
+                    if (!set(setting, value, 1, UINT8_MAX))
+                        return false;
+                    pattern.set_step_ticks(setting);
+                }
+                break;
+            case STEP:
+                if (current_key == "index")
+                    step_index = (int)std::clamp<int64_t>(value, -1, Pattern::MAX_STEPS);
+                else if (current_key == "flags")
+                    return set(step.flags, value, 0, UINT8_MAX);
+                else if (current_key == "note")
+                    return set(step.note, value, 0, 127);
+                else if (current_key == "velocity")
+                    return set(step.velocity, value, 0, 127);
+                else if (current_key == "gate")
+                    return set(step.gate_percent, value, 0, UINT8_MAX);
+                else if (current_key == "probability")
+                    return set(step.probability, value, 0, 100);
+                else if (current_key == "offset")
+                    return set(step.offset_ticks, value, INT8_MIN, INT8_MAX);
+                break;
+            case SCENE:
+                if (current_key == "length_bars")
+                    return set(scene.length_bars, value, 0, UINT8_MAX);
+                else if (current_key == "repeats")
+                    return set(scene.repeats, value, 0, UINT8_MAX);
+                else if (current_key == "jump_target")
+                    return set(scene.jump_target, value, 0, UINT16_MAX);
+                break;
+            case SCENE_PATTERNS: {
+                uint16_t id = 0;
+                if (!set(id, value, 0, UINT16_MAX))
+                    return false;
+                add_scene_pattern(id);
+                break;
+            }
+            default:
+                break;
+        }
+        return true;
+    }
+
+    void add_scene_pattern(uint16_t id) {
+        if (scene_track < Track::MAX_TRACKS)
+            scene.pattern_ids[scene_track++] = id;
+    }
+
+    Project& project;
+
+    Context stack[MAX_DEPTH];
+    int depth = 0;
+    std::string current_key;
+
+    // What was found of what is required, for is_complete()
+    bool have_root = false;
+    bool have_version = false;
+    int have_lists = 0;
+    bool have_scene_patterns = false;
+
+    // Objects being filled in
+    Track track;
+    int num_tracks = 0;
+    Pattern pattern;
+    Step step;
+    int step_index = -1;
+    Scene scene;
+    int scene_track = 0;
+};
+
+// Scenes can refer to patterns before they have all been read, so ids are only
+// validated once everything is loaded
+static bool finish(bool ok, const ProjectSaxHandler& handler, Project& project) {
+    if (!ok || !handler.is_complete()) {
+        project.clear();
+        return false;
+    }
+
+    remove_invalid_pattern_ids(project);
+    return true;
+}
+
+bool project_from_json_stream(std::istream& input, Project& project) {
+    project.clear();
+    ProjectSaxHandler handler(project);
+    return finish(json::sax_parse(input, &handler), handler, project);
+}
+
+bool project_from_json_text(const char* text, size_t size, Project& project) {
+    project.clear();
+    ProjectSaxHandler handler(project);
+    return finish(json::sax_parse(text, text + size, &handler), handler, project);
+}
+
+bool load_project_json_streaming(const std::string& path, Project& project) {
+    std::ifstream file(path);
+    if (!file) {
+        log_warning("Could not open %s", path.c_str());
+        project.clear();
+        return false;
+    }
+    return project_from_json_stream(file, project);
+}
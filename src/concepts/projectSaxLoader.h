@@ -0,0 +1,23 @@
+#ifndef PROJECT_SAX_LOADER_H
+#define PROJECT_SAX_LOADER_H
+
+// Loads a project from its JSON form using nlohmann's SAX interface. Unlike
+// load_project_json(), no json DOM is built: tracks, patterns and scenes are filled in
+// directly as the text is parsed, so peak memory is little more than the project
+// itself. Accepts the same JSON as project_from_json(); unknown keys are skipped.
+//
+// Returns false if the JSON is invalid or of a newer version, in which case the
+// project is left cleared.
+
+#include <cstddef>
+#include <istream>
+#include <string>
+
+#include "project.h"
+
+bool project_from_json_stream(std::istream& input, Project& project);
+bool project_from_json_text(const char* text, size_t size, Project& project);
+
+bool load_project_json_streaming(const std::string& path, Project& project);
+
+#endif  // PROJECT_SAX_LOADER_H
@@ -0,0 +1,208 @@
+#include "song.h"
+
+#include <algorithm>
+
+#include "../util/fastRandom.h"
+
+int Song::add_scene(const Scene& new_scene) {
+    if ((int)scenes.size() >= MAX_SCENES)
+        return NO_SCENE;
+
+    scenes.push_back(new_scene);
+    return (int)scenes.size() - 1;
+}
+
+void Song::clear() {
+    edit_channel.stop();
+    edited = nullptr;
+    play_patterns(nullptr);
+    bars_remaining = 0;
+    playback.store(PlaybackState().pack(), std::memory_order_release);
+    scenes.clear();
+}
+
+Song& Song::set_beats_per_bar(int beats) {
+    beats_per_bar = std::max(beats, 1);
+
+    // So can chain calls
+    return *this;
+}
+
+void Song::queue_scene(int index) {
+    if (index < 0 || index >= (int)scenes.size())
+        return;
+
+    // Unqueue any earlier scene first. Otherwise the clock thread could switch to it
+    // while its patterns are being evicted to make room for this one.
+    set_pending(NOTHING_QUEUED);
+
+    // Make sure patterns are available before the clock thread can switch to the scene.
+    // If the clock thread moved on in the meantime then do it again for where it is now.
+    uint32_t packed = playback.load(std::memory_order_acquire);
+    PlaybackState state;
+    do {
+        state = PlaybackState::unpack(packed);
+        materialize_scenes(state.current, state.next, index);
+        state.pending = index;
+    } while (!playback.compare_exchange_weak(packed, state.pack(), std::memory_order_acq_rel,
+                                             std::memory_order_acquire));
+}
+
+void Song::queue_stop() {
+    set_pending(STOP_QUEUED);
+}
+
+void Song::prepare() {
+    PlaybackState state = PlaybackState::unpack(playback.load(std::memory_order_acquire));
+    materialize_scenes(state.current, state.next, state.pending);
+}
+
+void Song::materialize_scenes(int current, int next, int queued) {
+    uint16_t ids[PatternStore::CACHE_SLOTS];
+    int count = 0;
+    for (int index : {current, next, queued}) {
+        if (index < 0 || index >= (int)scenes.size())
+            continue;
+        for (uint16_t id : scenes[index].pattern_ids) {
+            if (id != PatternStore::NO_PATTERN && std::find(ids, ids + count, id) == ids + count)
+                ids[count++] = id;
+        }
+    }
+
+    store.retain_only(ids, count);
+    for (int i = 0; i < count; ++i)
+        store.materialize(ids[i]);
+}
+
+void Song::set_pending(int pending) {
+    uint32_t packed = playback.load(std::memory_order_acquire);
+    PlaybackState state;
+    do {
+        state = PlaybackState::unpack(packed);
+        state.pending = pending;
+    } while (!playback.compare_exchange_weak(packed, state.pack(), std::memory_order_acq_rel,
+                                             std::memory_order_acquire));
+}
+
+PatternEditChannel* Song::edit_pattern(uint16_t id) {
+    end_edit();
+
+    Pattern pattern;
+    if (!store.load(id, pattern))
+        return nullptr;
+    edit_channel.start(id, pattern);
+    return &edit_channel;
+}
+
+void Song::end_edit() {
+    uint16_t id = edit_channel.get_id();
+    if (id == PatternStore::NO_PATTERN)
+        return;
+
+    // Stored before the channel lets go of it, so the clock thread finds the new
+    // version in the store once it stops playing the edited one
+    store.store(id, edit_channel.last_published());
+    edit_channel.stop();
+}
+
+void Song::tick(uint32_t ppqn_count, int ppqn) {
+    // Taken before looking for changed patterns, for when an edit was just stored
+    edited = &edit_channel.current();
+
+    // Move over to the new versions of patterns that were changed while playing
+    uint32_t replacements = store.replacement_count();
+    if (replacements != seen_replacements) {
+        seen_replacements = replacements;
+        for (const Pattern*& pattern : current_patterns) {
+            if (pattern)
+                pattern = store.repin(pattern);
+        }
+    }
+
+    // Clock's ppqn_count starts at 1, so first tick is start of a bar
+    if ((ppqn_count - 1) % (uint32_t)(ppqn * beats_per_bar) == 0)
+        on_bar();
+}
+
+void Song::on_bar() {
+    PlaybackState state = PlaybackState::unpack(playback.load(std::memory_order_acquire));
+    if (state.pending != NOTHING_QUEUED) {
+        enter_scene();
+        return;
+    }
+
+    if (state.current == NO_SCENE)
+        return;
+
+    if (--bars_remaining > 0) {
+        // A pattern might not have been materialized in time when the scene was
+        // entered. Pick it up now if prepare() has caught up.
+        const Scene& playing = scenes[state.current];
+        for (int track = 0; track < Track::MAX_TRACKS; ++track) {
+            if (!current_patterns[track]) {
+                current_patterns[track] = store.pin(playing.pattern_ids[track]);
+                current_ids[track] = playing.pattern_ids[track];
+            }
+        }
+        return;
+    }
+
+    enter_scene();
+}
+
+void Song::enter_scene() {
+    // The UI thread can queue a scene at the same time, in which case go there instead
+    uint32_t packed = playback.load(std::memory_order_acquire);
+    PlaybackState entered;
+    do {
+        PlaybackState state = PlaybackState::unpack(packed);
+        int index = state.pending != NOTHING_QUEUED ? state.pending : state.next;
+        entered = PlaybackState();
+        if (index >= 0 && index < (int)scenes.size()) {
+            entered.current = index;
+            entered.next = follow_target(index);
+        }
+    } while (!playback.compare_exchange_weak(packed, entered.pack(), std::memory_order_acq_rel,
+                                             std::memory_order_acquire));
+
+    if (entered.current == NO_SCENE) {
+        play_patterns(nullptr);
+        return;
+    }
+
+    const Scene& scene = scenes[entered.current];
+    play_patterns(&scene);
+    bars_remaining = std::max(scene.length_bars * scene.repeats, 1);
+}
+
+void Song::play_patterns(const Scene* scene) {
+    // Pin the new pattern before unpinning the old one, in case they are the same
+    for (int track = 0; track < Track::MAX_TRACKS; ++track) {
+        const Pattern* pattern = scene ? store.pin(scene->pattern_ids[track]) : nullptr;
+        if (current_patterns[track])
+            store.unpin(current_patterns[track]);
+        current_patterns[track] = pattern;
+        current_ids[track] = scene ? scene->pattern_ids[track] : PatternStore::NO_PATTERN;
+    }
+}
+
+int Song::follow_target(int index) const {
+    int count = (int)scenes.size();
+    switch (scenes[index].follow_action) {
+        case Scene::LOOP:
+            return index;
+        case Scene::NEXT:
+            return index + 1 < count ? index + 1 : NO_SCENE;
+        case Scene::PREVIOUS:
+            return index > 0 ? index - 1 : NO_SCENE;
+        case Scene::FIRST:
+            return 0;
+        case Scene::RANDOM:
+            return fast_rand(0, count - 1);
+        case Scene::JUMP:
+            return scenes[index].jump_target < count ? scenes[index].jump_target : NO_SCENE;
+        case Scene::STOP:
+        default:
+            return NO_SCENE;
+    }
+}
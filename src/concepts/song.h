@@ -0,0 +1,188 @@
+#ifndef SONG_H
+#define SONG_H
+
+// A Song is an ordered list of Scenes. A Scene specifies which pattern each track plays,
+// how many bars it lasts, how many times it repeats, and what happens afterwards (the
+// follow action). Scene changes, whether queued by the user or due to a follow action,
+// take effect on a bar boundary.
+//
+// Threading: the clock thread calls tick(), which switches scenes using only patterns
+// that are already materialized in the PatternStore. The UI thread calls everything
+// else, including prepare(), which materializes the patterns of the current, queued, and
+// following scenes and lets the store evict the rest. The current, following and queued
+// scenes are published together in a single atomic word, so the UI thread always sees
+// where the clock thread is and where it can go next, and the clock thread pins the
+// patterns it is playing so that they are never evicted from under it. When the UI
+// thread changes a playing pattern the clock thread moves over to the new version at
+// the next tick. A pattern being edited is passed to the clock thread through a
+// PatternEditChannel instead, so that edits are heard as they are made without storing
+// every one. Scenes should only be added or changed while the song is stopped.
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "patternEditChannel.h"
+#include "patternStore.h"
+#include "track.h"
+
+struct Scene {
+    enum FollowAction : uint8_t { LOOP, NEXT, PREVIOUS, FIRST, RANDOM, JUMP, STOP };
+
+    Scene() {
+        for (uint16_t& id : pattern_ids)
+            id = PatternStore::NO_PATTERN;
+    }
+
+    // Pattern for each track, or NO_PATTERN if track is silent for the scene
+    uint16_t pattern_ids[Track::MAX_TRACKS];
+
+    // Number of bars for a single pass through the scene
+    uint8_t length_bars = 1;
+
+    // Number of times the scene is played before the follow action applies
+    uint8_t repeats = 1;
+
+    FollowAction follow_action = NEXT;
+
+    // Scene to go to for JUMP follow action
+    uint16_t jump_target = 0;
+};
+
+class Song {
+   public:
+    static inline constexpr int NO_SCENE = -1;
+    static inline constexpr int MAX_SCENES = 1000;
+
+    Song(PatternStore& pattern_store) : store(pattern_store) {}
+
+    // Adds a scene to the end of the song. Returns the index of the new scene, or
+    // NO_SCENE if there are already MAX_SCENES.
+    int add_scene(const Scene& scene);
+
+    Scene& scene(int index) {
+        return scenes[index];
+    }
+    const Scene& scene(int index) const {
+        return scenes[index];
+    }
+
+    int num_scenes() const {
+        return (int)scenes.size();
+    }
+
+    // Removes all scenes and stops playback. Resets state that the clock thread owns, so
+    // must not be called while the clock thread could be calling tick().
+    void clear();
+
+    Song& set_beats_per_bar(int beats);
+    int get_beats_per_bar() const {
+        return beats_per_bar;
+    }
+
+    // Queues the scene to start on the next bar boundary. Also used to start the song.
+    void queue_scene(int index);
+
+    // Queues the song to stop on the next bar boundary
+    void queue_stop();
+
+    // Materializes the patterns that are needed for the current, queued, and following
+    // scenes, and evicts all others. Should be called periodically from the UI thread.
+    void prepare();
+
+    // Index of scene being played, or NO_SCENE if stopped
+    int get_current_scene() const {
+        return PlaybackState::unpack(playback.load(std::memory_order_acquire)).current;
+    }
+
+    // The pattern that the track should currently play, or nullptr if none. The
+    // published version if the pattern is being edited.
+    const Pattern* current_pattern(int track) const {
+        if (edited && current_patterns[track] && edited->id == current_ids[track])
+            return &edited->pattern;
+        return current_patterns[track];
+    }
+
+    // UI thread. Starts editing the pattern, ending any earlier edit. Edits made to the
+    // channel's edit() copy are played in place of the stored pattern each time they
+    // are published. Returns nullptr if there is no such pattern.
+    PatternEditChannel* edit_pattern(uint16_t id);
+
+    // UI thread. Stores the last published version of the pattern being edited in the
+    // PatternStore, and stops editing it. Unpublished edits are discarded.
+    void end_edit();
+
+    // To be called for every PPQN tick of the Clock, with the Clock's ppqn_count and PPQN
+    void tick(uint32_t ppqn_count, int ppqn);
+
+   private:
+    // Value of pending for when there is nothing queued, and for a queued stop
+    static inline constexpr int NOTHING_QUEUED = -2;
+    static inline constexpr int STOP_QUEUED = NO_SCENE;
+
+    // Scene being played, where its follow action leads, and what is queued. Packed into
+    // a single word, each scene index offset by 2 so that the special values fit.
+    struct PlaybackState {
+        static inline constexpr int BITS = 10;
+        static inline constexpr uint32_t MASK = (1 << BITS) - 1;
+
+        int current = NO_SCENE;
+        int next = NO_SCENE;
+        int pending = NOTHING_QUEUED;
+
+        uint32_t pack() const {
+            return (uint32_t)(current + 2) | (uint32_t)(next + 2) << BITS |
+                   (uint32_t)(pending + 2) << (2 * BITS);
+        }
+
+        static PlaybackState unpack(uint32_t packed) {
+            return {(int)(packed & MASK) - 2, (int)(packed >> BITS & MASK) - 2,
+                    (int)(packed >> (2 * BITS) & MASK) - 2};
+        }
+    };
+    static_assert(MAX_SCENES + 2 <= (int)PlaybackState::MASK, "Scene index must fit");
+
+    // Materializes the patterns of the specified scenes, and evicts all others
+    void materialize_scenes(int current, int next, int queued);
+
+    // Replaces the queued scene, leaving the rest of the state as it is
+    void set_pending(int pending);
+
+    // Called on clock thread at each bar boundary
+    void on_bar();
+
+    // Switches to the queued scene, or if none to the next one. Called on the clock
+    // thread.
+    void enter_scene();
+
+    // Pins the patterns of the scene, or none if nullptr, in place of the current ones
+    void play_patterns(const Scene* scene);
+
+    // Scene that the follow action of the specified scene leads to
+    int follow_target(int index) const;
+
+    PatternStore& store;
+    std::vector<Scene> scenes;
+    int beats_per_bar = 4;
+
+    // The next scene is determined when a scene is entered so that a RANDOM target can
+    // be prepared ahead of time
+    std::atomic<uint32_t> playback{PlaybackState().pack()};
+
+    // Bars left before the follow action of the current scene applies
+    int bars_remaining = 0;
+
+    // Only accessed by the clock thread. Pinned in the PatternStore.
+    const Pattern* current_patterns[Track::MAX_TRACKS] = {};
+    uint16_t current_ids[Track::MAX_TRACKS] = {};
+
+    // Pattern being edited, taken from edit_channel at the start of each tick. Only
+    // accessed by the clock thread.
+    PatternEditChannel edit_channel;
+    const PatternEditChannel::Version* edited = nullptr;
+
+    // The store's replacement_count() when current_patterns were last brought up to date
+    uint32_t seen_replacements = 0;
+};
+
+#endif  // SONG_H
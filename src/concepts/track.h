@@ -0,0 +1,21 @@
+#ifndef TRACK_H
+#define TRACK_H
+
+// A Track is one voice of the sequencer. Which Pattern a track plays is determined by
+// the current Scene of the Song.
+
+#include <cstdint>
+
+struct Track {
+    static inline constexpr int MAX_TRACKS = 16;
+    static inline constexpr int MAX_NAME_LENGTH = 15;
+
+    enum Type : uint8_t { NOTE, DRUM, MODULATION };
+
+    char name[MAX_NAME_LENGTH + 1] = {};
+    Type type = NOTE;
+    uint8_t midi_channel = 0;
+    bool muted = false;
+};
+
+#endif  // TRACK_H
@@ -1,16 +1,32 @@
+#include <cstdlib>
 #include <iostream>
 #include <thread>
 
-#define DEBUG
+#define LOG_MODULE_NAME "main"
 #include "seq/clock.h"
+#include "util/asyncLog.h"
 #include "util/debug.h"
+#include "util/flightRecorder.h"
 #include "util/fastRandom.h"
 #include "util/json.hpp"
+#include "util/trace.h"
 
 // Just for testing json
 #include <fstream>
 
 int main() {
+    // This test program shows everything it logs. Levels can then be changed in
+    // log.conf, such as "clock=debug storage=info".
+    log_set_level("main", LOG_LEVEL_DEBUG);
+    log_load_config("log.conf");
+
+    // Writes what real-time threads such as the clock log
+    async_log_start();
+
+    // So there is a history of what happened if it crashes or the clock gets stuck
+    flight_recorder_install_crash_handler("flight.log");
+    flight_watchdog_start(std::chrono::milliseconds(500));
+
     debug("This is a test of the debug macro");
 
     using json = nlohmann::json;
@@ -35,10 +51,28 @@ int main() {
 
     debug("Starting Clock test...");
 
+    // With SEQUENCER_TRACE_FILE set, trace the start of the run
+    const char* trace_path = getenv("SEQUENCER_TRACE_FILE");
+    if (trace_path) {
+#ifndef TRACE
+        log_warning("Built without SEQUENCER_TRACE, so the trace will be empty");
+#endif
+        trace_thread_name("main");
+        trace_start();
+    }
+
     // Run separate thread forever (for now)
     Clock& clock = Clock::create();
     clock.set_BPM(60).set_PPQN(24).run();
 
+    if (trace_path) {
+        const char* seconds = getenv("SEQUENCER_TRACE_SECONDS");
+        std::this_thread::sleep_for(std::chrono::seconds(seconds ? atoi(seconds) : 10));
+        trace_stop();
+        if (trace_write_json(trace_path))
+            log_info("Wrote %zu trace events to %s", trace_event_count(), trace_path);
+    }
+
     // Don't terminate main thread. Let clock thread run forever.
     clock.join();
 
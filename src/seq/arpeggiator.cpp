@@ -0,0 +1,247 @@
+#include "arpeggiator.h"
+
+#include <algorithm>
+
+Arpeggiator& Arpeggiator::set_mode(Mode new_mode) {
+    mode = new_mode;
+    rebuild_notes();
+
+    // So can chain calls
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_octaves(int new_octaves) {
+    octaves = std::clamp(new_octaves, 1, MAX_OCTAVES);
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_step_ticks(int ticks) {
+    step_ticks = std::max(ticks, 1);
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_gate_percent(int percent) {
+    gate_percent = std::clamp(percent, 1, 100);
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_ratchets(int new_ratchets) {
+    ratchets = std::clamp(new_ratchets, 1, MAX_RATCHETS);
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_channel(uint8_t new_channel) {
+    channel = new_channel & 0x0F;
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_seed(uint32_t seed) {
+    random = StepRandom(seed);
+    return *this;
+}
+
+Arpeggiator& Arpeggiator::set_chord(const int* intervals, int count) {
+    count = std::clamp(count, 0, MAX_CHORD_SIZE - 1);
+    for (int i = 0; i < count; ++i)
+        chord_intervals[i] = intervals[i];
+    chord_size = count + 1;
+    rebuild_notes();
+
+    return *this;
+}
+
+void Arpeggiator::note_on(uint8_t note, uint8_t velocity) {
+    note &= 0x7F;
+
+    // Insert into sorted position, or just update velocity if already held
+    HeldNote* end = held + num_held;
+    HeldNote* position = std::lower_bound(
+        held, end, note, [](const HeldNote& held_note, uint8_t n) { return held_note.note < n; });
+    if (position != end && position->note == note) {
+        position->velocity = velocity;
+    } else {
+        if (num_held == MAX_HELD_NOTES)
+            return;
+        std::move_backward(position, end, end + 1);
+        *position = {note, velocity, next_played_order++};
+        ++num_held;
+    }
+
+    rebuild_notes();
+}
+
+void Arpeggiator::note_off(uint8_t note) {
+    note &= 0x7F;
+
+    HeldNote* end = held + num_held;
+    HeldNote* position = std::lower_bound(
+        held, end, note, [](const HeldNote& held_note, uint8_t n) { return held_note.note < n; });
+    if (position == end || position->note != note)
+        return;
+
+    std::move(position + 1, end, position);
+    --num_held;
+
+    // So the next notes pressed start from the beginning of the arpeggio
+    if (num_held == 0)
+        step_index = 0;
+
+    rebuild_notes();
+}
+
+void Arpeggiator::all_notes_off(uint32_t ppqn_count) {
+    num_held = 0;
+    step_index = 0;
+    rebuild_notes();
+    release_notes(ppqn_count, true);
+}
+
+void Arpeggiator::rebuild_notes() {
+    // Get held notes in the order they are to be arpeggiated
+    HeldNote ordered[MAX_HELD_NOTES];
+    std::copy(held, held + num_held, ordered);
+    if (mode == AS_PLAYED) {
+        std::sort(ordered, ordered + num_held, [](const HeldNote& a, const HeldNote& b) {
+            return a.played_order < b.played_order;
+        });
+    }
+
+    // Expand each held note into a chord
+    num_notes = 0;
+    for (int i = 0; i < num_held; ++i) {
+        for (int c = 0; c < chord_size; ++c) {
+            int note = ordered[i].note + (c == 0 ? 0 : chord_intervals[c - 1]);
+            if (note < 0 || note > 127)
+                continue;
+            notes[num_notes] = (uint8_t)note;
+            velocities[num_notes] = ordered[i].velocity;
+            ++num_notes;
+        }
+    }
+
+    // Chord tones of different held notes can interleave or coincide, so sort by pitch
+    // and remove duplicates. For AS_PLAYED the played order is kept instead.
+    if (mode != AS_PLAYED && chord_size > 1) {
+        int indexes[MAX_NOTES];
+        for (int i = 0; i < num_notes; ++i)
+            indexes[i] = i;
+        std::sort(indexes, indexes + num_notes,
+                  [this](int a, int b) { return notes[a] < notes[b]; });
+
+        uint8_t sorted_notes[MAX_NOTES];
+        uint8_t sorted_velocities[MAX_NOTES];
+        int count = 0;
+        for (int i = 0; i < num_notes; ++i) {
+            if (count > 0 && sorted_notes[count - 1] == notes[indexes[i]])
+                continue;
+            sorted_notes[count] = notes[indexes[i]];
+            sorted_velocities[count] = velocities[indexes[i]];
+            ++count;
+        }
+        std::copy(sorted_notes, sorted_notes + count, notes);
+        std::copy(sorted_velocities, sorted_velocities + count, velocities);
+        num_notes = count;
+    }
+}
+
+void Arpeggiator::select_step_notes() {
+    num_step_notes = 0;
+    if (num_notes == 0)
+        return;
+
+    uint32_t total = num_notes * octaves;
+    uint32_t index;
+    switch (mode) {
+        case DOWN:
+            index = total - 1 - step_index % total;
+            break;
+        case UP_DOWN: {
+            // Ping-pong without repeating the top and bottom notes
+            uint32_t period = total > 1 ? 2 * total - 2 : 1;
+            index = step_index % period;
+            if (index >= total)
+                index = period - index;
+            break;
+        }
+        case RANDOM:
+            index = random.range(step_index, 0, total - 1);
+            break;
+        case CHORD: {
+            // All notes of an octave at once, stepping through the octaves
+            int octave = step_index % octaves;
+            for (int i = 0; i < num_notes; ++i) {
+                int note = notes[i] + 12 * octave;
+                if (note > 127)
+                    continue;
+                step_notes[num_step_notes] = (uint8_t)note;
+                step_velocities[num_step_notes] = velocities[i];
+                ++num_step_notes;
+            }
+            ++step_index;
+            return;
+        }
+        case UP:
+        case AS_PLAYED:
+        default:
+            index = step_index % total;
+            break;
+    }
+    ++step_index;
+
+    int note = notes[index % num_notes] + 12 * (index / num_notes);
+    if (note > 127)
+        return;
+    step_notes[0] = (uint8_t)note;
+    step_velocities[0] = velocities[index % num_notes];
+    num_step_notes = 1;
+}
+
+void Arpeggiator::trigger_step_notes(uint32_t ppqn_count, int gate_ticks) {
+    for (int i = 0; i < num_step_notes && num_sounding < MAX_NOTES; ++i) {
+        NoteEvent event;
+        event.tick = ppqn_count;
+        event.type = NoteEvent::NOTE_ON;
+        event.channel = channel;
+        event.note = step_notes[i];
+        event.velocity = step_velocities[i];
+        if (!output.push(event))
+            return;
+
+        sounding[num_sounding++] = {step_notes[i], ppqn_count + gate_ticks};
+    }
+}
+
+void Arpeggiator::release_notes(uint32_t ppqn_count, bool release_all) {
+    int remaining = 0;
+    for (int i = 0; i < num_sounding; ++i) {
+        // Signed difference so that wrapping of the tick count is handled
+        if (release_all || (int32_t)(ppqn_count - sounding[i].off_tick) >= 0) {
+            NoteEvent event;
+            event.tick = ppqn_count;
+            event.type = NoteEvent::NOTE_OFF;
+            event.channel = channel;
+            event.note = sounding[i].note;
+            if (output.push(event))
+                continue;
+        }
+        sounding[remaining++] = sounding[i];
+    }
+    num_sounding = remaining;
+}
+
+void Arpeggiator::tick(uint32_t ppqn_count) {
+    // Release first so that a note retriggered on this tick gets a fresh NOTE_ON
+    release_notes(ppqn_count, false);
+
+    // Clock's ppqn_count starts at 1, so the first tick is the start of a step
+    uint32_t position = (ppqn_count - 1) % step_ticks;
+    int ratchet_ticks = std::max(step_ticks / ratchets, 1);
+    if (position % ratchet_ticks != 0 || (int)(position / ratchet_ticks) >= ratchets)
+        return;
+
+    if (position == 0)
+        select_step_notes();
+
+    int gate_ticks = std::max(ratchet_ticks * gate_percent / 100, 1);
+    trigger_step_notes(ppqn_count, gate_ticks);
+}
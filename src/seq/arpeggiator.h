@@ -0,0 +1,142 @@
+#ifndef ARPEGGIATOR_H
+#define ARPEGGIATOR_H
+
+// Arpeggiator and chord generator. Takes held notes and, driven by the Clock's PPQN
+// ticks, emits NOTE_ON/NOTE_OFF events into an EventQueue.
+//
+// Each held note can be expanded into a chord by set_chord(). The resulting notes are
+// then either played one at a time according to the arpeggiator mode, or all at once
+// in CHORD mode.
+//
+// Held notes are kept in fixed size arrays, so nothing allocates memory. All methods
+// are expected to be called from the same thread, typically the clock thread.
+
+#include <cstdint>
+
+#include "../util/fastRandom.h"
+#include "events.h"
+
+class Arpeggiator {
+   public:
+    enum Mode { UP, DOWN, UP_DOWN, RANDOM, AS_PLAYED, CHORD };
+
+    static inline constexpr int MAX_HELD_NOTES = 16;
+    static inline constexpr int MAX_CHORD_SIZE = 4;
+    static inline constexpr int MAX_OCTAVES = 4;
+    static inline constexpr int MAX_RATCHETS = 8;
+
+    // Max number of notes after chord expansion. Also the most notes that can sound at once.
+    static inline constexpr int MAX_NOTES = MAX_HELD_NOTES * MAX_CHORD_SIZE;
+
+    Arpeggiator(EventQueue& output_queue) : output(output_queue) {}
+
+    Arpeggiator& set_mode(Mode mode);
+
+    // Number of octaves the arpeggio spans, 1 to MAX_OCTAVES
+    Arpeggiator& set_octaves(int octaves);
+
+    // Length of each arpeggiator step in PPQN ticks. For 16th notes at 24 PPQN use 6.
+    Arpeggiator& set_step_ticks(int ticks);
+
+    // Gate length as a percentage of a step (or of a ratchet if ratcheting), 1 to 100
+    Arpeggiator& set_gate_percent(int percent);
+
+    // Number of times each step is retriggered within the step, 1 to MAX_RATCHETS
+    Arpeggiator& set_ratchets(int ratchets);
+
+    // MIDI channel used for the generated events
+    Arpeggiator& set_channel(uint8_t channel);
+
+    // Each held note is expanded into the note plus the intervals, in semitones.
+    // Up to MAX_CHORD_SIZE-1 intervals are used. Use count of 0 for no chord.
+    Arpeggiator& set_chord(const int* intervals, int count);
+
+    // Seed for RANDOM mode. The note chosen for a step only depends on the seed and the
+    // step index, so the same steps always play the same notes.
+    Arpeggiator& set_seed(uint32_t seed);
+
+    // Sets which step of the arpeggio is next, for when the transport is located
+    void set_step_index(uint32_t index) {
+        step_index = index;
+    }
+
+    // Called when a note is pressed. Ignored if MAX_HELD_NOTES already held.
+    void note_on(uint8_t note, uint8_t velocity);
+
+    // Called when a note is released. Once no notes are held, the arpeggio starts from
+    // its first step again.
+    void note_off(uint8_t note);
+
+    // Releases all held notes and turns off any sounding notes. The arpeggio starts from
+    // its first step again.
+    void all_notes_off(uint32_t ppqn_count);
+
+    // Number of notes currently held
+    int held_count() const {
+        return num_held;
+    }
+
+    // To be called for every PPQN tick of the Clock, with the Clock's ppqn_count
+    void tick(uint32_t ppqn_count);
+
+   private:
+    struct HeldNote {
+        uint8_t note;
+        uint8_t velocity;
+        // Increasing number so that AS_PLAYED order can be determined
+        uint32_t played_order;
+    };
+
+    struct SoundingNote {
+        uint8_t note;
+        uint32_t off_tick;
+    };
+
+    // Rebuilds the notes to be played from the held notes and the chord
+    void rebuild_notes();
+
+    // Determines which notes are to be played for the next step
+    void select_step_notes();
+
+    // Sends NOTE_ON for the step notes and remembers when they need to be turned off
+    void trigger_step_notes(uint32_t ppqn_count, int gate_ticks);
+
+    // Sends NOTE_OFF for all sounding notes whose gate ends at or before ppqn_count
+    void release_notes(uint32_t ppqn_count, bool release_all);
+
+    EventQueue& output;
+
+    Mode mode = UP;
+    int octaves = 1;
+    int step_ticks = 6;
+    int gate_percent = 50;
+    int ratchets = 1;
+    uint8_t channel = 0;
+    StepRandom random;
+
+    int chord_intervals[MAX_CHORD_SIZE - 1];
+    int chord_size = 1;
+
+    // Held notes, sorted by pitch
+    HeldNote held[MAX_HELD_NOTES];
+    int num_held = 0;
+    uint32_t next_played_order = 0;
+
+    // Notes to arpeggiate, after chord expansion. Sorted by pitch except in AS_PLAYED mode.
+    uint8_t notes[MAX_NOTES];
+    uint8_t velocities[MAX_NOTES];
+    int num_notes = 0;
+
+    // Notes selected for the current step
+    uint8_t step_notes[MAX_NOTES];
+    uint8_t step_velocities[MAX_NOTES];
+    int num_step_notes = 0;
+
+    SoundingNote sounding[MAX_NOTES];
+    int num_sounding = 0;
+
+    // Which step of the arpeggio is next
+    uint32_t step_index = 0;
+};
+
+#endif  // ARPEGGIATOR_H
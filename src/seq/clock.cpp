@@ -1,11 +1,15 @@
 #include "clock.h"
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <thread>
 
-#define DEBUG
+#define LOG_MODULE_NAME "clock"
+#include "../util/asyncLog.h"
 #include "../util/debug.h"
+#include "../util/flightRecorder.h"
+#include "../util/trace.h"
 
 Clock& Clock::create() {
     Clock* clock_ptr = new Clock();
@@ -16,17 +20,20 @@ Clock& Clock::create() {
 }
 
 void Clock::run() {
-    debug("Running clock %s...", name.c_str());
+    log_info("Running clock %s...", name.c_str());
+    flight_record("clock run", bpm);
     state = RUNNING;
 }
 
 void Clock::pause() {
-    debug("Pausing clock %s...", name.c_str());
+    log_info("Pausing clock %s...", name.c_str());
+    flight_record("clock pause", ppqn_count.load(std::memory_order_relaxed));
     state = PAUSED;
 }
 
 void Clock::reset_counts() {
-    debug("Resetting clock %s...", name.c_str());
+    log_info("Resetting clock %s...", name.c_str());
+    flight_record("clock reset", ppqn_count.load(std::memory_order_relaxed));
     bpm_count = 0;
     ppqn_count = 0;
 }
@@ -62,6 +69,13 @@ Clock& Clock::set_PPQN(int new_ppqn) {
     return *this;
 }
 
+Clock& Clock::set_spin_time(std::chrono::nanoseconds spin) {
+    spin_time_ns.store(std::max<int64_t>(spin.count(), 0), std::memory_order_relaxed);
+
+    // So can chain calls
+    return *this;
+}
+
 Clock& Clock::add_BPM_callback(void (*callback)(uint32_t, uint32_t)) {
     bpm_callbacks.push_back(callback);
     return *this;
@@ -107,44 +121,88 @@ std::chrono::steady_clock::duration Clock::determine_sleep_time() {
 }
 
 
+void Clock::tick() {
+    trace_scope("tick");
+    uint32_t count = ++ppqn_count;
+    // debug("Calling ppqn callbacks for ppqn_count=%d", count);
+    for (auto callback : ppqn_callbacks)
+        callback(count);
+
+    if ((count - 1) % ppqn == 0) {
+        bpm_count++;
+        trace_instant("beat");
+
+        // Once a beat rather than each tick, so the ring still reaches back several
+        // bars. Late ticks are recorded in loop().
+        flight_record("beat", count);
+        async_log_debug("Calling bpm callbacks for bpm_count=%d ppqn_count=%d", bpm_count, count);
+        for (auto callback : bpm_callbacks)
+            callback(bpm_count, count);
+    }
+}
+
 void Clock::loop() {
     debug("In loop for clock %s...", name.c_str());
 
+    // Logging from the loop is asynchronous, so it can't block on stderr
+    async_log_register_thread();
+    trace_thread_name("clock");
+
     // So can determine how late next tick is compared to when it should have been
     reset_clock_timing();
 
     // Loops each PPWN clock tick
-    while (true) {
+    while (!stopping.load(std::memory_order_relaxed)) {
         // If the clock timer reset time hasn't been initialized, do so now
         if (clock_reset_time.time_since_epoch().count() == 0) 
             clock_reset_time = std::chrono::steady_clock::now();
 
-        if (state == RUNNING) {
-            ppqn_count++;
-            // debug("Calling ppqn callbacks for ppqn_count=%d", ppqn_count);
-            for (auto callback : ppqn_callbacks)
-                callback(ppqn_count);
-
-            if ((ppqn_count - 1) % ppqn == 0) {
-                bpm_count++;
-                debug("Calling bpm callbacks for bpm_count=%d ppqn_count=%d", bpm_count, ppqn_count);
-                for (auto callback : bpm_callbacks)
-                    callback(bpm_count, ppqn_count);
-            }
-        }
+        // Kicked even while paused, since the watchdog is for the loop getting stuck
+        flight_watchdog_kick();
+
+        if (state == RUNNING)
+            tick();
 
         // Sleep until next PPQN tick
         std::chrono::duration sleep_time = determine_sleep_time();
+        std::chrono::nanoseconds spin_time(spin_time_ns.load(std::memory_order_relaxed));
         //debug("Sleeping for %.6f seconds", sleep_time.count()/1'000'000'000.0);
-        if (sleep_time.count() > 0) {
-            std::this_thread::sleep_for(sleep_time);
+        if (sleep_time.count() > 0 && spin_time.count() == 0) {
+            sleep_until(std::chrono::steady_clock::now() + sleep_time);
+        } else if (sleep_time.count() > 0) {
+            // Sleeps for most of the wait and then spins until the tick is due
+            auto wake_time = std::chrono::steady_clock::now() + sleep_time;
+            if (sleep_time > spin_time)
+                sleep_until(wake_time - spin_time);
+            while (std::chrono::steady_clock::now() < wake_time) {
+            }
         } else {
-            debug("Clock tick took too long. Not sleeping.");
+            trace_instant("late");
+            flight_record("tick late ns",
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(-sleep_time).count());
+            async_log_debug("Clock tick took too long. Not sleeping.");
         }
     }
 }
 
+void Clock::sleep_until(std::chrono::steady_clock::time_point wake_time) {
+    auto now = std::chrono::steady_clock::now();
+    while (now < wake_time) {
+        std::this_thread::sleep_until(std::min(wake_time, now + MAX_SLEEP_BETWEEN_KICKS));
+        flight_watchdog_kick();
+        now = std::chrono::steady_clock::now();
+    }
+}
+
 void Clock::join() {
     debug("Joining clock %s...", name.c_str());
     thread.join();
 }
+
+void Clock::stop() {
+    log_info("Stopping clock %s...", name.c_str());
+    flight_record("clock stop", ppqn_count.load(std::memory_order_relaxed));
+    stopping = true;
+    if (thread.joinable())
+        thread.join();
+}
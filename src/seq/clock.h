@@ -1,9 +1,13 @@
 #ifndef CLOCK_H
 #define CLOCK_H
 
+#include <atomic>
 #include <chrono>
-#include <thread>
+#include <cstdint>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 class Clock {
    public:
@@ -29,6 +33,17 @@ class Clock {
         return ppqn;
     }
 
+    // Number of PPQN ticks that have occurred. Can be called from any thread, such as
+    // for timestamping incoming notes.
+    uint32_t get_PPQN_count() const {
+        return ppqn_count.load(std::memory_order_relaxed);
+    }
+
+    // Spins for the last part of the wait before each tick instead of sleeping, since
+    // the scheduler can wake a sleeping thread late. Uses more CPU. 0, the default,
+    // sleeps for the whole wait.
+    Clock& set_spin_time(std::chrono::nanoseconds spin);
+
     Clock& add_BPM_callback(void (*bpm_callback)(uint32_t, uint32_t));
 
     Clock& add_PPQN_callback(void (*ppqn_callback)(uint32_t));
@@ -36,6 +51,9 @@ class Clock {
     // So that main thread can continue to run while the clock thread is running
     void join();
 
+    // Makes the clock thread exit after its current tick, and waits for it
+    void stop();
+
    protected:
     static inline constexpr int DEFAULT_BPM = 120;
     static inline constexpr int MIN_BPM = 20;
@@ -44,13 +62,27 @@ class Clock {
     static inline constexpr int DEFAULT_PPQN = 24;
     static inline constexpr int MIN_PPQN = 1;
     static inline constexpr int MAX_PPQN = 192;
+
+    // Longest the loop sleeps between kicks of the flight recorder watchdog, so that
+    // slow tempos don't trigger it. Ticks can be up to 3 seconds apart.
+    static inline constexpr std::chrono::milliseconds MAX_SLEEP_BETWEEN_KICKS{50};
  
     // This function is to do the abusrdly complicated converting of a double to a duration
     static std::chrono::steady_clock::duration convert_to_duration(double seconds);
 
+    // Constructor is protected to force create() to be used instead, though
+    // benchmarks can derive from Clock to drive ticks themselves
+    Clock() {}
+
+    // Increments the counts and calls the callbacks for one PPQN tick
+    void tick();
+
     // The main loop that processes each clock tick
     void loop();
 
+    // Sleeps until the specified time, kicking the watchdog along the way
+    void sleep_until(std::chrono::steady_clock::time_point wake_time);
+
     // Called when clock frequency is changed. Resets the counts so that can 
     // determine exactly when PPQN clock tick should occur.
     void reset_clock_timing();
@@ -60,9 +92,6 @@ class Clock {
     std::chrono::steady_clock::duration determine_sleep_time();
 
    private:
-    // Constructor is private to force start() to be used instead
-    Clock() {}
-
     // The separate thread that the clock loop runs in
     std::thread thread;
 
@@ -74,11 +103,16 @@ class Clock {
     long clock_ticks_since_reset;
     std::recursive_mutex clock_reset_mutex;
 
+    // In nanoseconds. Atomic since set from other threads while the clock runs.
+    std::atomic<int64_t> spin_time_ns{0};
+
+    std::atomic<bool> stopping{false};
+
     // Number of times BPM tick has occurred
     int bpm_count = 0;
 
-    // Number of times PPQN tick has occurred
-    int ppqn_count = 0;
+    // Number of times PPQN tick has occurred. Atomic since read by other threads.
+    std::atomic<uint32_t> ppqn_count{0};
 
     // BPM is Beats Per Minute
     int bpm = DEFAULT_BPM;
@@ -0,0 +1,64 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// Note events and the queue used to pass them between the stages of the sequencer.
+// Nothing here allocates memory, so events can be generated and consumed from the
+// clock thread without risking a stall in the allocator.
+
+#include <atomic>
+#include <cstdint>
+
+struct NoteEvent {
+    enum Type : uint8_t { NOTE_OFF = 0, NOTE_ON = 1 };
+
+    // PPQN tick that the event belongs to
+    uint32_t tick = 0;
+
+    Type type = NOTE_OFF;
+    uint8_t channel = 0;
+    uint8_t note = 0;
+    uint8_t velocity = 0;
+};
+
+// Fixed size single-producer single-consumer queue of NoteEvents. One thread may call
+// push() while another calls pop(), without any locking.
+class EventQueue {
+   public:
+    // Must be a power of 2 so that indexes can simply be masked
+    static inline constexpr uint32_t CAPACITY = 256;
+
+    // Adds event to the queue. Returns false, and drops the event, if the queue is full.
+    bool push(const NoteEvent& event) {
+        uint32_t head = write_index.load(std::memory_order_relaxed);
+        if (head - read_index.load(std::memory_order_acquire) >= CAPACITY)
+            return false;
+
+        events[head & (CAPACITY - 1)] = event;
+        write_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Removes the oldest event from the queue. Returns false if queue is empty.
+    bool pop(NoteEvent& event) {
+        uint32_t tail = read_index.load(std::memory_order_relaxed);
+        if (tail == write_index.load(std::memory_order_acquire))
+            return false;
+
+        event = events[tail & (CAPACITY - 1)];
+        read_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Number of events currently in the queue
+    uint32_t size() const {
+        return write_index.load(std::memory_order_acquire) -
+               read_index.load(std::memory_order_acquire);
+    }
+
+   private:
+    NoteEvent events[CAPACITY];
+    std::atomic<uint32_t> write_index{0};
+    std::atomic<uint32_t> read_index{0};
+};
+
+#endif  // EVENTS_H
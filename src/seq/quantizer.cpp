@@ -0,0 +1,119 @@
+#include "quantizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+Quantizer::Quantizer() {
+    set_scale(CHROMATIC);
+}
+
+Quantizer& Quantizer::set_scale(uint16_t new_mask, int root) {
+    new_mask &= ALL_NOTES_MASK;
+    if (new_mask == 0)
+        new_mask = ALL_NOTES_MASK;
+
+    float degree_cents[NOTES_PER_OCTAVE];
+    int count = 0;
+    for (int semitone = 0; semitone < NOTES_PER_OCTAVE; ++semitone) {
+        if (new_mask & (1 << semitone))
+            degree_cents[count++] = semitone * 100.0f;
+    }
+
+    root = ((root % NOTES_PER_OCTAVE) + NOTES_PER_OCTAVE) % NOTES_PER_OCTAVE;
+    build_tables(degree_cents, count, 1200.0f, root * 100.0f);
+
+    // Store mask relative to C so that it can be compared to other scales
+    mask = ((new_mask << root) | (new_mask >> (NOTES_PER_OCTAVE - root))) & ALL_NOTES_MASK;
+
+    // So can chain calls
+    return *this;
+}
+
+Quantizer& Quantizer::set_chord(const int* intervals, int count, int root) {
+    uint16_t chord_mask = 0;
+    for (int i = 0; i < count; ++i) {
+        int semitone = ((intervals[i] % NOTES_PER_OCTAVE) + NOTES_PER_OCTAVE) % NOTES_PER_OCTAVE;
+        chord_mask |= 1 << semitone;
+    }
+
+    return set_scale(chord_mask, root);
+}
+
+Quantizer& Quantizer::set_microtonal_scale(const float* degree_cents, int count,
+                                           float period_cents, int root) {
+    if (period_cents <= 0.0f)
+        period_cents = 1200.0f;
+    count = std::clamp(count, 0, MAX_MICROTONAL_DEGREES);
+
+    // Fold degrees into a single period, then sort and remove duplicates so that the
+    // nearest degree can be found by a simple scan
+    float degrees[MAX_MICROTONAL_DEGREES];
+    for (int i = 0; i < count; ++i) {
+        float folded = std::fmod(degree_cents[i], period_cents);
+        degrees[i] = folded < 0.0f ? folded + period_cents : folded;
+    }
+    std::sort(degrees, degrees + count);
+    count = std::unique(degrees, degrees + count) - degrees;
+
+    // No degrees means just the root
+    if (count == 0) {
+        degrees[0] = 0.0f;
+        count = 1;
+    }
+
+    float root_cents = std::clamp(root, 0, NUM_NOTES - 1) * 100.0f;
+    build_tables(degrees, count, period_cents, root_cents);
+
+    // Nearest semitones of the first octave of the scale
+    mask = 0;
+    for (int i = 0; i < count; ++i) {
+        float cents = root_cents + degrees[i];
+        if (degrees[i] >= 1200.0f)
+            break;
+        int semitone = (int)std::lround(cents / 100.0f) % NOTES_PER_OCTAVE;
+        mask |= 1 << semitone;
+    }
+
+    return *this;
+}
+
+float Quantizer::nearest_pitch(float cents, const float* degree_cents, int count,
+                               float period_cents, float root_cents) {
+    float relative = cents - root_cents;
+    float period_start = std::floor(relative / period_cents) * period_cents;
+    float offset = relative - period_start;
+
+    // The nearest degree can also be the last degree of the previous period or the
+    // first degree of the next one. On a tie the lower pitch wins.
+    float best = degree_cents[count - 1] - period_cents;
+    float best_distance = offset - best;
+    for (int i = 0; i < count; ++i) {
+        float distance = std::fabs(offset - degree_cents[i]);
+        if (distance < best_distance) {
+            best = degree_cents[i];
+            best_distance = distance;
+        }
+    }
+    float next_period = degree_cents[0] + period_cents;
+    if (next_period - offset < best_distance)
+        best = next_period;
+
+    return root_cents + period_start + best;
+}
+
+void Quantizer::build_tables(const float* degree_cents, int count, float period_cents,
+                             float root_cents) {
+    for (int note = 0; note < NUM_NOTES; ++note) {
+        float cents = nearest_pitch(note * 100.0f, degree_cents, count, period_cents, root_cents);
+        long quantized = std::lround(cents / 100.0f);
+        note_table[note] = (uint8_t)std::clamp(quantized, 0L, (long)NUM_NOTES - 1);
+    }
+
+    // Pitch of each entry is worked out in whole cents rather than from its voltage, so
+    // that an entry exactly between two degrees goes to the lower one like notes do
+    for (int index = 0; index < VOLTAGE_TABLE_SIZE; ++index) {
+        float entry_cents = (index + MIN_VOLTAGE * STEPS_PER_VOLT) * (1200.0f / STEPS_PER_VOLT);
+        float cents = nearest_pitch(entry_cents, degree_cents, count, period_cents, root_cents);
+        voltage_table[index] = cents / 1200.0f;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+// Quantizer snaps notes and 1V/oct voltages to a scale. All the work is done when the
+// scale is configured: a lookup table is built for MIDI notes and another one for
+// voltages, so quantizing on every step or control-rate sample is just a table index.
+//
+// A scale can be a 12-TET mask (bit N set means semitone N above the root is in the scale),
+// a set of chord tones, or an arbitrary microtonal scale given in cents.
+
+#include <cstdint>
+
+class Quantizer {
+   public:
+    static inline constexpr int NOTES_PER_OCTAVE = 12;
+    static inline constexpr int NUM_NOTES = 128;
+    static inline constexpr uint16_t ALL_NOTES_MASK = 0x0FFF;
+
+    // Voltage range covered by the voltage table. Voltages outside are clamped.
+    static inline constexpr float MIN_VOLTAGE = -5.0f;
+    static inline constexpr float MAX_VOLTAGE = 10.0f;
+
+    // Resolution of voltage table. 120 entries per volt means 10 cents per entry, which
+    // is far finer than the resolution of a 12-bit DAC over a 10V range.
+    static inline constexpr int STEPS_PER_VOLT = 120;
+    static inline constexpr int VOLTAGE_TABLE_SIZE =
+        (int)((MAX_VOLTAGE - MIN_VOLTAGE) * STEPS_PER_VOLT) + 1;
+
+    // Maximum number of degrees in a microtonal scale
+    static inline constexpr int MAX_MICROTONAL_DEGREES = 64;
+
+    // Common 12-TET scales as masks. Bit 0 is the root.
+    enum ScaleMask : uint16_t {
+        CHROMATIC = 0x0FFF,
+        MAJOR = 0x0AB5,             // 0 2 4 5 7 9 11
+        NATURAL_MINOR = 0x05AD,     // 0 2 3 5 7 8 10
+        HARMONIC_MINOR = 0x09AD,    // 0 2 3 5 7 8 11
+        MELODIC_MINOR = 0x0AAD,     // 0 2 3 5 7 9 11
+        DORIAN = 0x06AD,            // 0 2 3 5 7 9 10
+        PHRYGIAN = 0x05AB,          // 0 1 3 5 7 8 10
+        LYDIAN = 0x0AD5,            // 0 2 4 6 7 9 11
+        MIXOLYDIAN = 0x06B5,        // 0 2 4 5 7 9 10
+        LOCRIAN = 0x056B,           // 0 1 3 5 6 8 10
+        MAJOR_PENTATONIC = 0x0295,  // 0 2 4 7 9
+        MINOR_PENTATONIC = 0x04A9,  // 0 3 5 7 10
+        BLUES = 0x04E9,             // 0 3 5 6 7 10
+        WHOLE_TONE = 0x0555,        // 0 2 4 6 8 10
+    };
+
+    // Common chords as masks, for use with set_scale() or as the result of set_chord()
+    enum ChordMask : uint16_t {
+        MAJOR_TRIAD = 0x0091,       // 0 4 7
+        MINOR_TRIAD = 0x0089,       // 0 3 7
+        DIMINISHED_TRIAD = 0x0049,  // 0 3 6
+        AUGMENTED_TRIAD = 0x0111,   // 0 4 8
+        MAJOR_SEVENTH = 0x0891,     // 0 4 7 11
+        MINOR_SEVENTH = 0x0489,     // 0 3 7 10
+        DOMINANT_SEVENTH = 0x0491,  // 0 4 7 10
+    };
+
+    // Starts out as a chromatic quantizer, which for notes is a pass-through
+    Quantizer();
+
+    // Configures a 12-TET scale. Root is the pitch class (0=C) that bit 0 of the mask
+    // refers to. An empty mask is treated as chromatic.
+    Quantizer& set_scale(uint16_t mask, int root = 0);
+
+    // Configures the quantizer to only allow the specified chord tones. The intervals are
+    // in semitones above the root and can span multiple octaves; they are folded into
+    // a single octave.
+    Quantizer& set_chord(const int* intervals, int count, int root = 0);
+
+    // Configures a microtonal scale. Degrees are in cents above the root and repeat every
+    // period_cents (1200 for an octave based scale). Root is a MIDI note number, which
+    // allows the scale to be anchored to a non-C root. Degrees beyond
+    // MAX_MICROTONAL_DEGREES are ignored.
+    Quantizer& set_microtonal_scale(const float* degree_cents, int count,
+                                    float period_cents = 1200.0f, int root = 0);
+
+    // Returns the 12-TET mask in use, relative to C. For microtonal scales this is the
+    // mask of the nearest semitones.
+    uint16_t get_mask() const {
+        return mask;
+    }
+
+    // Returns the nearest allowed note to the specified MIDI note
+    uint8_t quantize_note(uint8_t note) const {
+        return note_table[note & 0x7F];
+    }
+
+    // Returns the nearest allowed voltage for a 1V/oct input, where 0V is MIDI note 0.
+    float quantize_voltage(float volts) const {
+        float position = (volts - MIN_VOLTAGE) * STEPS_PER_VOLT + 0.5f;
+        int index = (int)position;
+        if (index < 0) index = 0;
+        if (index >= VOLTAGE_TABLE_SIZE) index = VOLTAGE_TABLE_SIZE - 1;
+        return voltage_table[index];
+    }
+
+   private:
+    // Fills in both tables given the scale degrees in cents over a repeating period.
+    // Degrees must be sorted and within [0, period_cents).
+    void build_tables(const float* degree_cents, int count, float period_cents,
+                      float root_cents);
+
+    // Returns the allowed pitch, in cents, nearest the specified pitch
+    static float nearest_pitch(float cents, const float* degree_cents, int count,
+                               float period_cents, float root_cents);
+
+    uint16_t mask = ALL_NOTES_MASK;
+    uint8_t note_table[NUM_NOTES];
+    float voltage_table[VOLTAGE_TABLE_SIZE];
+};
+
+#endif  // QUANTIZER_H
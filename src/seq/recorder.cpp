@@ -0,0 +1,141 @@
+#include "recorder.h"
+
+#include <algorithm>
+
+Recorder& Recorder::set_mode(Mode new_mode) {
+    mode = new_mode;
+
+    // So can chain calls
+    return *this;
+}
+
+Recorder& Recorder::set_quantize_percent(int percent) {
+    quantize_percent = std::clamp(percent, 0, 100);
+    return *this;
+}
+
+Recorder& Recorder::set_swing_percent(int percent) {
+    swing_percent = std::clamp(percent, 50, 75);
+    return *this;
+}
+
+void Recorder::start(uint32_t ppqn_count) {
+    start_tick = ppqn_count;
+    last_step = -1;
+    recorded_steps = 0;
+    num_open = 0;
+    recording = true;
+}
+
+void Recorder::stop(uint32_t ppqn_count) {
+    while (num_open > 0)
+        note_off(ppqn_count, open_notes[0].note);
+    recording = false;
+}
+
+int Recorder::pattern_position(uint32_t ppqn_count) const {
+    // Signed so that a note played just before recording started lands at the end
+    int ticks = (int32_t)(ppqn_count - start_tick);
+    int length_ticks = channel.edit().get_length_ticks();
+    return ((ticks % length_ticks) + length_ticks) % length_ticks;
+}
+
+void Recorder::quantize(int position, int& step_index, int& offset_ticks) const {
+    const Pattern& pattern = channel.edit();
+    int step_ticks = pattern.get_step_ticks();
+
+    // Nearest grid point, where every odd grid point is delayed by the swing
+    int swing_ticks = 2 * step_ticks * swing_percent / 100 - step_ticks;
+    int index = position / step_ticks;
+    int best_index = index;
+    int best_distance = step_ticks * 2;
+    for (int candidate = index - 1; candidate <= index + 1; ++candidate) {
+        int grid = candidate * step_ticks + ((candidate & 1) ? swing_ticks : 0);
+        int distance = std::abs(position - grid);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best_index = candidate;
+        }
+    }
+
+    // Move towards the grid according to the strength. What's left is micro-timing,
+    // relative to the straight (unswung) step position.
+    int grid = best_index * step_ticks + ((best_index & 1) ? swing_ticks : 0);
+    int quantized = position + (grid - position) * quantize_percent / 100;
+    int offset = quantized - best_index * step_ticks;
+
+    int length = pattern.get_length();
+    step_index = ((best_index % length) + length) % length;
+    offset_ticks = std::clamp(offset, -128, 127);
+}
+
+void Recorder::tick(uint32_t ppqn_count) {
+    if (!recording || mode != REPLACE)
+        return;
+
+    Pattern& pattern = channel.edit();
+    int step_index = pattern_position(ppqn_count) / pattern.get_step_ticks();
+    if (step_index == last_step)
+        return;
+    last_step = step_index;
+
+    // Entering a step. Keep it if a note was just recorded into it, otherwise clear it.
+    uint64_t bit = (uint64_t)1 << step_index;
+    if (recorded_steps & bit) {
+        recorded_steps &= ~bit;
+    } else if (pattern.step(step_index).flags & Step::ACTIVE) {
+        pattern.step(step_index).flags &= ~Step::ACTIVE;
+        channel.publish();
+    }
+}
+
+void Recorder::record(const NoteEvent& event) {
+    if (!recording)
+        return;
+
+    if (event.type == NoteEvent::NOTE_ON && event.velocity > 0)
+        note_on(event.tick, event.note, event.velocity);
+    else
+        note_off(event.tick, event.note);
+}
+
+void Recorder::note_on(uint32_t tick, uint8_t note, uint8_t velocity) {
+    int step_index, offset_ticks;
+    quantize(pattern_position(tick), step_index, offset_ticks);
+
+    Step& step = channel.edit().step(step_index);
+    step.flags = Step::ACTIVE;
+    step.note = note;
+    step.velocity = velocity;
+    step.offset_ticks = (int8_t)offset_ticks;
+    step.gate_percent = 100;
+    step.probability = 100;
+    channel.publish();
+
+    // If the step is ahead of the playhead, don't let REPLACE clear it
+    if (step_index != last_step)
+        recorded_steps |= (uint64_t)1 << step_index;
+
+    if (num_open < MAX_OPEN_NOTES)
+        open_notes[num_open++] = {note, (uint8_t)step_index, tick};
+}
+
+void Recorder::note_off(uint32_t tick, uint8_t note) {
+    for (int i = 0; i < num_open; ++i) {
+        if (open_notes[i].note != note)
+            continue;
+
+        // Gate is the held duration as a percentage of a step
+        uint32_t duration = tick - open_notes[i].start_tick;
+        Pattern& pattern = channel.edit();
+        int gate = (int)(duration * 100 / pattern.get_step_ticks());
+        Step& step = pattern.step(open_notes[i].step_index);
+        if (step.note == note) {
+            step.gate_percent = (uint8_t)std::clamp(gate, 1, 255);
+            channel.publish();
+        }
+
+        open_notes[i] = open_notes[--num_open];
+        return;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+// Recorder captures incoming notes into a Pattern while it plays. Notes are timestamped
+// with the Clock's PPQN count (see Clock::get_PPQN_count()) when they arrive, and are
+// then placed on the nearest step. Quantization can be partial: with a strength below
+// 100% the remaining offset from the grid is kept as the step's micro-timing. Swing
+// delays every other grid position.
+//
+// In OVERDUB mode recorded notes are added to the pattern. In REPLACE mode steps that
+// the playhead passes over are cleared unless a note was just recorded into them.
+//
+// Records into the pattern being edited through a PatternEditChannel, normally the
+// Song's (see Song::edit_pattern()), and publishes each change, so the clock thread
+// plays the recorded notes without the pattern ever being written while it is read.
+// It therefore runs on the UI thread, the only one that may write to the channel, and
+// is fed from an EventQueue of notes timestamped on arrival. Never allocates.
+
+#include <cstdint>
+
+#include "../concepts/patternEditChannel.h"
+#include "events.h"
+
+class Recorder {
+   public:
+    enum Mode { OVERDUB, REPLACE };
+
+    static inline constexpr int MAX_OPEN_NOTES = 16;
+
+    // The channel must be editing the pattern to record into while recording
+    Recorder(PatternEditChannel& edit_channel) : channel(edit_channel) {}
+
+    Recorder& set_mode(Mode mode);
+
+    // How far notes are moved towards the grid, 0 (not at all) to 100 (fully)
+    Recorder& set_quantize_percent(int percent);
+
+    // Position of every second grid point, 50 (straight) to 75 (heavy swing)
+    Recorder& set_swing_percent(int percent);
+
+    // Starts recording, with ppqn_count being the tick that the pattern starts on
+    void start(uint32_t ppqn_count);
+
+    // Stops recording. Notes still held are ended at the ppqn_count.
+    void stop(uint32_t ppqn_count);
+
+    bool is_recording() const {
+        return recording;
+    }
+
+    // Records a timestamped NOTE_ON or NOTE_OFF event
+    void record(const NoteEvent& event);
+
+    // To be called for every PPQN tick of the Clock while recording, before any events
+    // for that tick are recorded. Needed for REPLACE mode. Since the UI thread doesn't
+    // run each tick, it calls this for each tick since its last call, up to
+    // Clock::get_PPQN_count().
+    void tick(uint32_t ppqn_count);
+
+   private:
+    struct OpenNote {
+        uint8_t note;
+        uint8_t step_index;
+        uint32_t start_tick;
+    };
+
+    // Position within the pattern, in ticks, for the ppqn_count
+    int pattern_position(uint32_t ppqn_count) const;
+
+    // Quantized step index and micro-timing offset for the position
+    void quantize(int position, int& step_index, int& offset_ticks) const;
+
+    void note_on(uint32_t tick, uint8_t note, uint8_t velocity);
+    void note_off(uint32_t tick, uint8_t note);
+
+    PatternEditChannel& channel;
+    Mode mode = OVERDUB;
+    int quantize_percent = 100;
+    int swing_percent = 50;
+
+    bool recording = false;
+    uint32_t start_tick = 0;
+
+    // Step the playhead was last in, for REPLACE mode
+    int last_step = -1;
+
+    // Steps that were recorded into ahead of the playhead, so REPLACE doesn't clear them
+    uint64_t recorded_steps = 0;
+
+    OpenNote open_notes[MAX_OPEN_NOTES];
+    int num_open = 0;
+};
+
+#endif  // RECORDER_H
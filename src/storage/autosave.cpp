@@ -0,0 +1,347 @@
+#include "autosave.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define LOG_MODULE_NAME "storage"
+#include "../concepts/projectIO.h"
+#include "../util/crc32.h"
+#include "../util/debug.h"
+#include "../util/flightRecorder.h"
+#include "../util/trace.h"
+
+Autosave::Autosave(Project& project_to_save, const std::string& file_path)
+    : project(project_to_save), path(file_path) {}
+
+Autosave::~Autosave() {
+    stop();
+}
+
+Autosave& Autosave::set_interval(std::chrono::milliseconds new_interval) {
+    interval = new_interval;
+
+    // So can chain calls
+    return *this;
+}
+
+void Autosave::start() {
+    if (thread.joinable())
+        return;
+
+    need_snapshot = true;
+    stopping = false;
+    bytes_written = 0;
+    last_collect = std::chrono::steady_clock::now();
+    thread = std::thread(&Autosave::writer_loop, this);
+}
+
+void Autosave::stop() {
+    if (!thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake_writer.notify_one();
+    thread.join();
+}
+
+void Autosave::update() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_collect >= interval)
+        collect();
+}
+
+template <typename WritePayload>
+void Autosave::append_chunk(std::vector<uint8_t>& buffer, ChunkType type, uint16_t id,
+                            WritePayload&& write_payload) {
+    // Write header with a placeholder length and CRC, then fill them in afterwards
+    size_t header_start = buffer.size();
+    ByteWriter out(buffer);
+    out.u8(type);
+    out.u16(id);
+    out.u32(0);
+    out.u32(0);
+    write_payload(out);
+
+    uint32_t length = (uint32_t)(buffer.size() - header_start - CHUNK_HEADER_SIZE);
+    for (int byte = 0; byte < 4; ++byte)
+        buffer[header_start + 3 + byte] = (uint8_t)(length >> (8 * byte));
+
+    uint32_t crc = crc32(&buffer[header_start + CHUNK_HEADER_SIZE], length,
+                         crc32(&buffer[header_start], 7));
+    for (int byte = 0; byte < 4; ++byte)
+        buffer[header_start + 7 + byte] = (uint8_t)(crc >> (8 * byte));
+}
+
+void Autosave::collect_changes(std::vector<uint8_t>& buffer) {
+    if (project.settings_dirty) {
+        append_chunk(buffer, SETTINGS, 0, [&](ByteWriter& out) { write_project_settings(out, project); });
+        project.settings_dirty = false;
+    }
+
+    for (int track = 0; track < Track::MAX_TRACKS; ++track) {
+        if (!(project.dirty_tracks & (1u << track)))
+            continue;
+        append_chunk(buffer, TRACK, track,
+                     [&](ByteWriter& out) { write_track(out, project.tracks[track]); });
+    }
+    project.dirty_tracks = 0;
+
+    for (int id = 0; id < project.patterns.size(); ++id) {
+        if (!project.patterns.is_dirty(id))
+            continue;
+        const std::vector<uint8_t>& bytes = project.patterns.serialized_pattern(id);
+        append_chunk(buffer, PATTERN, id,
+                     [&](ByteWriter& out) { out.raw(bytes.data(), bytes.size()); });
+        project.patterns.clear_dirty(id);
+    }
+
+    if (project.song_dirty) {
+        append_chunk(buffer, SCENES, 0, [&](ByteWriter& out) { write_scenes(out, project.song); });
+        project.song_dirty = false;
+    }
+}
+
+void Autosave::collect() {
+    trace_scope("autosave collect");
+    last_collect = std::chrono::steady_clock::now();
+
+    {
+        // What was collected before may not be in the file, so start over with a
+        // snapshot, which has everything
+        std::lock_guard<std::mutex> lock(mutex);
+        if (write_failed)
+            need_snapshot = true;
+    }
+
+    std::vector<uint8_t> buffer;
+    bool replace = need_snapshot || logged_since_snapshot > COMPACT_RATIO * snapshot_size;
+    if (replace) {
+        std::vector<uint8_t> snapshot;
+        project_to_binary(project, snapshot);
+        append_chunk(buffer, SNAPSHOT, 0,
+                     [&](ByteWriter& out) { out.raw(snapshot.data(), snapshot.size()); });
+
+        // Everything is in the snapshot, so nothing is dirty anymore
+        project.clear_dirty();
+
+        need_snapshot = false;
+        snapshot_size = buffer.size();
+        logged_since_snapshot = 0;
+    } else {
+        collect_changes(buffer);
+        if (buffer.empty())
+            return;
+        logged_since_snapshot += buffer.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (replace) {
+            // Anything not yet written is superseded by the snapshot
+            pending = std::move(buffer);
+            pending_replaces_file = true;
+            write_failed = false;
+        } else if (!write_failed) {
+            pending.insert(pending.end(), buffer.begin(), buffer.end());
+        }
+    }
+    wake_writer.notify_one();
+}
+
+void Autosave::wait_until_written() {
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [this] { return pending.empty() && !writing; });
+}
+
+void Autosave::writer_loop() {
+#ifdef __linux__
+    // Only write when nothing else needs the CPU
+    sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+    trace_thread_name("autosave");
+    flight_recorder_install_thread_stack();
+
+    std::vector<uint8_t> buffer;
+    while (true) {
+        bool replace;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake_writer.wait(lock, [this] { return !pending.empty() || stopping; });
+            if (pending.empty())
+                break;
+
+            buffer.swap(pending);
+            pending.clear();
+            replace = pending_replaces_file;
+            pending_replaces_file = false;
+            writing = true;
+        }
+
+        bool ok = write_file(buffer, replace);
+        buffer.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            writing = false;
+
+            // Chunks appended after a failed write would be lost when loading, so drop
+            // them and have the next collect() write a snapshot instead. Unless a
+            // snapshot is already on its way, which replaces the file anyway.
+            if (!ok && !pending_replaces_file) {
+                pending.clear();
+                write_failed = true;
+            }
+        }
+        written.notify_all();
+    }
+}
+
+// Makes sure what was written to the file is on the storage device
+static bool sync_file(FILE* file) {
+    if (fflush(file) != 0)
+        return false;
+#ifdef __unix__
+    return fsync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+// Makes sure a rename in the directory holding the file is on the storage device
+static bool sync_directory(const std::string& file_path) {
+#ifdef __unix__
+    size_t slash = file_path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : file_path.substr(0, slash + 1);
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)file_path;
+    return true;
+#endif
+}
+
+bool Autosave::write_file(const std::vector<uint8_t>& buffer, bool replace) {
+    trace_scope("autosave write");
+
+    // A new snapshot is written to a temporary file, synced, and then renamed, so that
+    // there is always a complete file even if power is lost while writing. Without the
+    // sync the rename could reach the storage before the data does.
+    std::string write_path = replace ? path + ".tmp" : path;
+    FILE* file = fopen(write_path.c_str(), replace ? "wb" : "ab");
+    if (!file) {
+        log_warning("Could not open %s for autosave", write_path.c_str());
+        return false;
+    }
+    size_t written_size = fwrite(buffer.data(), 1, buffer.size(), file);
+    bool ok = written_size == buffer.size() && sync_file(file);
+    fclose(file);
+    bytes_written += written_size;
+
+    if (!ok) {
+        log_warning("Autosave write to %s failed", write_path.c_str());
+        return false;
+    }
+    if (!replace)
+        return true;
+    if (std::rename(write_path.c_str(), path.c_str()) != 0) {
+        log_warning("Could not rename %s to %s", write_path.c_str(), path.c_str());
+        return false;
+    }
+
+    // Otherwise the rename could be lost, and the chunks appended next would end up
+    // after the old snapshot
+    if (!sync_directory(path))
+        log_warning("Could not sync directory of %s", path.c_str());
+    return true;
+}
+
+bool Autosave::load(const std::string& file_path, Project& project) {
+    project.clear();
+
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file) {
+        log_warning("Could not open %s", file_path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+
+    ByteReader in(bytes.data(), bytes.size());
+    bool have_snapshot = false;
+    uint8_t version = PROJECT_BINARY_VERSION;
+    while (in.remaining() > 0) {
+        const uint8_t* header = in.raw(CHUNK_HEADER_SIZE);
+        const uint8_t* payload = nullptr;
+        ByteReader header_in(header, header ? CHUNK_HEADER_SIZE : 0);
+        ChunkType type = (ChunkType)header_in.u8();
+        uint16_t id = header_in.u16();
+        uint32_t length = header_in.u32();
+        uint32_t crc = header_in.u32();
+        if (header)
+            payload = in.raw(length);
+        if (!payload) {
+            log_warning("Ignoring truncated chunk at end of %s", file_path.c_str());
+            break;
+        }
+        if (crc != crc32(payload, length, crc32(header, 7))) {
+            log_warning("Ignoring chunk that fails its CRC, and the rest of %s",
+                        file_path.c_str());
+            break;
+        }
+
+        if (!have_snapshot && type != SNAPSHOT) {
+            log_warning("%s doesn't start with a snapshot", file_path.c_str());
+            return false;
+        }
+
+        ByteReader chunk(payload, length);
+        switch (type) {
+            case SNAPSHOT:
+                if (!project_from_binary(payload, length, project))
+                    return false;
+                have_snapshot = true;
+
+                // The chunks after a snapshot are written by the same program
+                version = payload[sizeof(PROJECT_BINARY_MAGIC)];
+                break;
+            case SETTINGS:
+                read_project_settings(chunk, project);
+                break;
+            case TRACK:
+                if (id < Track::MAX_TRACKS)
+                    read_track(chunk, project.tracks[id]);
+                break;
+            case PATTERN:
+                project.patterns.store_serialized(id, payload, length);
+                break;
+            case SCENES:
+                read_scenes(chunk, project.song, version);
+                break;
+            default:
+                log_warning("Unknown chunk type %d in %s", type, file_path.c_str());
+                break;
+        }
+    }
+
+    remove_invalid_pattern_ids(project);
+    return have_snapshot;
+}
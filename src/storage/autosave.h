@@ -0,0 +1,123 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+// Autosave incrementally saves a project. The file is a log of chunks: a full snapshot
+// of the project followed by chunks for the settings, tracks, patterns and scenes that
+// changed since. Loading replays the log, so the latest version of each chunk wins.
+// Each chunk has a CRC, so that a chunk torn by power loss, or the zeros a file system
+// can leave after the end of a file, end the log instead of being replayed.
+// When the log gets large compared to the snapshot a new snapshot is written,
+// replacing the file.
+//
+// Collecting the changes is cheap, since patterns are already kept serialized, and is
+// done on the UI thread by update(). The file writing, which can take a while on an
+// SD card, is done by a separate low priority writer thread. The UI thread only ever
+// holds the lock long enough to hand over a buffer, and the clock thread isn't
+// involved at all.
+//
+// Changes are found from the project's dirty flags, which collecting clears. So a
+// project that is autosaved must not also be saved with save_project_changes().
+// If a write fails, the next collect() writes a full snapshot, so the changes whose
+// flags were cleared still reach the file.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../concepts/project.h"
+
+class Autosave {
+   public:
+    static inline constexpr std::chrono::milliseconds DEFAULT_INTERVAL{5000};
+
+    // A new snapshot is written once the changes logged after the snapshot are this
+    // many times larger than the snapshot itself
+    static inline constexpr int COMPACT_RATIO = 4;
+
+    Autosave(Project& project, const std::string& path);
+
+    // Stops the writer thread, after writing whatever was already collected
+    ~Autosave();
+
+    // How often update() collects changes
+    Autosave& set_interval(std::chrono::milliseconds interval);
+
+    // Starts the writer thread. The first collect() writes a full snapshot.
+    void start();
+
+    // Writes whatever was already collected and stops the writer thread
+    void stop();
+
+    // UI thread. To be called regularly. Collects changes if the interval has elapsed.
+    void update();
+
+    // UI thread. Collects the changes right away and hands them to the writer thread.
+    void collect();
+
+    // Blocks until the writer thread has written everything collected so far
+    void wait_until_written();
+
+    // Total bytes written to the file since start()
+    size_t get_bytes_written() const {
+        return bytes_written.load(std::memory_order_relaxed);
+    }
+
+    // Loads a project from a file written by Autosave. Returns false if the file can't
+    // be read or doesn't start with a valid snapshot. Replay stops at the first chunk
+    // that is truncated or fails its CRC, such as from power being lost while writing,
+    // keeping what was loaded before it.
+    static bool load(const std::string& path, Project& project);
+
+   private:
+    enum ChunkType : uint8_t { SNAPSHOT, SETTINGS, TRACK, PATTERN, SCENES };
+
+    // Size of chunk header: type, id, payload length, and CRC of the rest of the header
+    // and the payload
+    static inline constexpr size_t CHUNK_HEADER_SIZE = 11;
+
+    // Appends a chunk to the buffer, with payload filled in by write_payload
+    template <typename WritePayload>
+    static void append_chunk(std::vector<uint8_t>& buffer, ChunkType type, uint16_t id,
+                             WritePayload&& write_payload);
+
+    // Collects the dirty parts of the project as chunks, clearing the dirty flags
+    void collect_changes(std::vector<uint8_t>& buffer);
+
+    void writer_loop();
+
+    // Writer thread. Writes a buffer to the file, either replacing it or appending.
+    // Returns false if it failed.
+    bool write_file(const std::vector<uint8_t>& buffer, bool replace);
+
+    Project& project;
+    std::string path;
+    std::chrono::milliseconds interval = DEFAULT_INTERVAL;
+    std::chrono::steady_clock::time_point last_collect;
+
+    // Only accessed by the UI thread
+    bool need_snapshot = true;
+    size_t snapshot_size = 0;
+    size_t logged_since_snapshot = 0;
+
+    // Shared between the UI and writer threads, protected by mutex
+    std::mutex mutex;
+    std::condition_variable wake_writer;
+    std::condition_variable written;
+    std::vector<uint8_t> pending;
+    bool pending_replaces_file = false;
+    bool writing = false;
+    bool stopping = false;
+
+    // Set when a write failed, until the snapshot that replaces the file is collected
+    bool write_failed = false;
+
+    std::thread thread;
+    std::atomic<size_t> bytes_written{0};
+};
+
+#endif  // AUTOSAVE_H
@@ -0,0 +1,101 @@
+#include "blockDevice.h"
+
+#include <algorithm>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+FileBlockDevice::FileBlockDevice(const std::string& path, int block_count, size_t block_size)
+    : blocks(block_count), block_bytes(block_size), erase_counts(block_count, 0) {
+    file = fopen(path.c_str(), "r+b");
+    if (file)
+        return;
+
+    // New device, so start with every block erased
+    file = fopen(path.c_str(), "w+b");
+    if (!file)
+        return;
+    std::vector<uint8_t> erased(block_bytes, ERASED_VALUE);
+    for (int block = 0; block < blocks; ++block)
+        fwrite(erased.data(), 1, erased.size(), file);
+    fflush(file);
+}
+
+FileBlockDevice::~FileBlockDevice() {
+    if (file)
+        fclose(file);
+}
+
+bool FileBlockDevice::in_range(int block, size_t offset, size_t size) const {
+    return file && powered && block >= 0 && block < blocks && offset + size <= block_bytes;
+}
+
+bool FileBlockDevice::read(int block, size_t offset, void* data, size_t size) {
+    if (!in_range(block, offset, size))
+        return false;
+    if (fseek(file, (long)(block * block_bytes + offset), SEEK_SET) != 0)
+        return false;
+    return fread(data, 1, size, file) == size;
+}
+
+bool FileBlockDevice::program(int block, size_t offset, const void* data, size_t size) {
+    if (!in_range(block, offset, size))
+        return false;
+
+    // Losing power partway through only writes the first part of the data
+    size_t to_write = size;
+    if (power_loss_pending && size >= bytes_until_power_loss) {
+        to_write = bytes_until_power_loss;
+        powered = false;
+        power_loss_pending = false;
+    } else if (power_loss_pending) {
+        bytes_until_power_loss -= size;
+    }
+
+    if (fseek(file, (long)(block * block_bytes + offset), SEEK_SET) != 0)
+        return false;
+    size_t written = fwrite(data, 1, to_write, file);
+    fflush(file);
+    bytes_programmed += written;
+
+    return powered && written == size;
+}
+
+bool FileBlockDevice::erase(int block) {
+    if (!in_range(block, 0, block_bytes))
+        return false;
+    if (fseek(file, (long)(block * block_bytes), SEEK_SET) != 0)
+        return false;
+
+    std::vector<uint8_t> erased(block_bytes, ERASED_VALUE);
+    bool ok = fwrite(erased.data(), 1, erased.size(), file) == erased.size();
+    ++erase_counts[block];
+    return ok;
+}
+
+bool FileBlockDevice::sync() {
+    if (!file || !powered)
+        return false;
+    if (fflush(file) != 0)
+        return false;
+#ifdef __unix__
+    return fsync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+void FileBlockDevice::simulate_power_loss_after(size_t bytes) {
+    power_loss_pending = true;
+    bytes_until_power_loss = bytes;
+}
+
+void FileBlockDevice::restore_power() {
+    powered = true;
+    power_loss_pending = false;
+}
+
+uint32_t FileBlockDevice::max_erase_count() const {
+    return erase_counts.empty() ? 0 : *std::max_element(erase_counts.begin(), erase_counts.end());
+}
@@ -0,0 +1,96 @@
+#ifndef BLOCK_DEVICE_H
+#define BLOCK_DEVICE_H
+
+// BlockDevice is the interface to raw storage that behaves like flash: storage is
+// divided into blocks, a block must be erased (set to all 0xFF) before it can be
+// programmed, and each erase wears the block out a little.
+//
+// FileBlockDevice implements it with a regular file, for the Linux host build. It
+// counts erases and programmed bytes so that wear can be measured, and can simulate
+// power being lost partway through a write.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class BlockDevice {
+   public:
+    static inline constexpr uint8_t ERASED_VALUE = 0xFF;
+
+    virtual ~BlockDevice() = default;
+
+    virtual size_t block_size() const = 0;
+    virtual int block_count() const = 0;
+
+    virtual bool read(int block, size_t offset, void* data, size_t size) = 0;
+
+    // Writes to a part of the block that has been erased
+    virtual bool program(int block, size_t offset, const void* data, size_t size) = 0;
+
+    virtual bool erase(int block) = 0;
+
+    // Makes sure everything programmed so far is durable
+    virtual bool sync() = 0;
+};
+
+class FileBlockDevice : public BlockDevice {
+   public:
+    static inline constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+
+    // Opens the file, creating it with all blocks erased if it doesn't exist yet
+    FileBlockDevice(const std::string& path, int block_count,
+                    size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~FileBlockDevice() override;
+
+    // Whether the file could be opened
+    bool is_open() const {
+        return file != nullptr;
+    }
+
+    size_t block_size() const override {
+        return block_bytes;
+    }
+    int block_count() const override {
+        return blocks;
+    }
+
+    bool read(int block, size_t offset, void* data, size_t size) override;
+    bool program(int block, size_t offset, const void* data, size_t size) override;
+    bool erase(int block) override;
+    bool sync() override;
+
+    // Simulates losing power once bytes more bytes have been programmed. The program()
+    // call that crosses the limit only writes part of its data, and from then on all
+    // operations fail until restore_power().
+    void simulate_power_loss_after(size_t bytes);
+    void restore_power();
+    bool has_power() const {
+        return powered;
+    }
+
+    // Wear statistics
+    uint32_t erase_count(int block) const {
+        return erase_counts[block];
+    }
+    uint32_t max_erase_count() const;
+    size_t total_bytes_programmed() const {
+        return bytes_programmed;
+    }
+
+   private:
+    bool in_range(int block, size_t offset, size_t size) const;
+
+    FILE* file = nullptr;
+    int blocks;
+    size_t block_bytes;
+    std::vector<uint32_t> erase_counts;
+    size_t bytes_programmed = 0;
+
+    bool powered = true;
+    bool power_loss_pending = false;
+    size_t bytes_until_power_loss = 0;
+};
+
+#endif  // BLOCK_DEVICE_H
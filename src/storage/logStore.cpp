@@ -0,0 +1,425 @@
+#include "logStore.h"
+
+#include <algorithm>
+
+#define LOG_MODULE_NAME "storage"
+#include "../util/byteBuffer.h"
+#include "../util/crc32.h"
+#include "../util/debug.h"
+
+// Identifies a block that is part of the log. "MLOG" in little endian.
+static constexpr uint32_t BLOCK_MAGIC = 0x474F4C4D;
+
+bool LogStore::mount() {
+    int count = device.block_count();
+    blocks.assign(count, BlockInfo());
+    index.clear();
+    staged.clear();
+    write_buffer.clear();
+    head_block = -1;
+    next_sequence = 1;
+    abort_pending = false;
+
+    // Find the blocks that are part of the log
+    std::vector<int> order;
+    for (int block = 0; block < count; ++block) {
+        uint8_t header[BLOCK_HEADER_SIZE];
+        if (!device.read(block, 0, header, sizeof(header)))
+            return false;
+        ByteReader in(header, sizeof(header));
+        uint32_t magic = in.u32();
+        uint32_t sequence = in.u32();
+        uint32_t crc = in.u32();
+        if (magic != BLOCK_MAGIC || crc != crc32(header, 8))
+            continue;
+
+        blocks[block].in_use = true;
+        blocks[block].sequence = sequence;
+        next_sequence = std::max(next_sequence, sequence + 1);
+        order.push_back(block);
+    }
+    if (order.empty())
+        return format();
+    std::sort(order.begin(), order.end(),
+              [this](int a, int b) { return blocks[a].sequence < blocks[b].sequence; });
+
+    // Replay the log. Updates only take effect once their commit record is seen.
+    std::vector<IndexUpdate> uncommitted;
+    bool complete = true;
+    for (int block : order) {
+        // The rest of a block after a partially written record is skipped. The next
+        // block, if there is one, was started when the log was mounted after that.
+        uint32_t end_offset;
+        complete = scan_block(block, uncommitted, end_offset);
+        head_block = block;
+        head_offset = end_offset;
+    }
+
+    // Can only append to the head block if the rest of it is still erased
+    std::vector<uint8_t> rest(device.block_size() - head_offset);
+    if (complete && !rest.empty()) {
+        complete = device.read(head_block, head_offset, rest.data(), rest.size()) &&
+                   std::all_of(rest.begin(), rest.end(), [](uint8_t byte) {
+                       return byte == BlockDevice::ERASED_VALUE;
+                   });
+    }
+    if (!complete) {
+        log_warning("Log ends with partially written record in block %d", head_block);
+        head_offset = device.block_size();
+    }
+    buffer_offset = head_offset;
+
+    if (!complete || !uncommitted.empty()) {
+        log_warning("Discarding %d records of an incomplete commit", (int)uncommitted.size());
+        if (!append_record(0, ABORT, nullptr, 0, nullptr) || !flush_buffer() || !device.sync())
+            return false;
+    }
+
+    return true;
+}
+
+bool LogStore::format() {
+    int count = device.block_count();
+    blocks.assign(count, BlockInfo());
+    for (int block = 0; block < count; ++block) {
+        if (!device.erase(block))
+            return false;
+        blocks[block].erased = true;
+    }
+
+    index.clear();
+    staged.clear();
+    write_buffer.clear();
+    head_block = -1;
+    next_sequence = 1;
+    abort_pending = false;
+    return start_new_block();
+}
+
+bool LogStore::scan_block(int block, std::vector<IndexUpdate>& uncommitted, uint32_t& end_offset) {
+    size_t block_size = device.block_size();
+    uint32_t offset = BLOCK_HEADER_SIZE;
+    std::vector<uint8_t> data;
+
+    while (offset + RECORD_HEADER_SIZE <= block_size) {
+        end_offset = offset;
+
+        uint8_t header[RECORD_HEADER_SIZE];
+        if (!device.read(block, offset, header, sizeof(header)))
+            return false;
+        if (std::all_of(header, header + sizeof(header),
+                        [](uint8_t byte) { return byte == BlockDevice::ERASED_VALUE; }))
+            return true;
+
+        ByteReader in(header, sizeof(header));
+        uint16_t key = in.u16();
+        RecordType type = (RecordType)in.u8();
+        in.u8();
+        uint32_t length = in.u32();
+        uint32_t crc = in.u32();
+        if (length > block_size - offset - RECORD_HEADER_SIZE)
+            return false;
+
+        data.resize(length);
+        if (!device.read(block, offset + RECORD_HEADER_SIZE, data.data(), length))
+            return false;
+        if (crc != crc32(data.data(), length, crc32(header, 8)))
+            return false;
+
+        switch (type) {
+            case DATA:
+                uncommitted.push_back({key, false, {block, offset, length}});
+                break;
+            case DELETE:
+                uncommitted.push_back({key, true, {}});
+                break;
+            case COMMIT:
+                for (const IndexUpdate& update : uncommitted)
+                    apply(update);
+                uncommitted.clear();
+                break;
+            case ABORT:
+                uncommitted.clear();
+                break;
+            default:
+                return false;
+        }
+
+        offset += record_size(length);
+    }
+
+    end_offset = std::min<uint32_t>(offset, block_size);
+    return true;
+}
+
+size_t LogStore::max_value_size() const {
+    return device.block_size() - BLOCK_HEADER_SIZE - RECORD_HEADER_SIZE;
+}
+
+bool LogStore::put(uint16_t key, const uint8_t* data, size_t size) {
+    if (size > max_value_size())
+        return false;
+
+    Staged& value = staged[key];
+    value.removed = false;
+    value.data.assign(data, data + size);
+    return true;
+}
+
+void LogStore::remove(uint16_t key) {
+    Staged& value = staged[key];
+    value.removed = true;
+    value.data.clear();
+}
+
+void LogStore::discard_staged() {
+    staged.clear();
+}
+
+int LogStore::blocks_needed(const std::vector<size_t>& data_sizes) const {
+    size_t block_size = device.block_size();
+    size_t offset = head_block >= 0 ? head_offset : block_size;
+    int needed = 0;
+    for (size_t size : data_sizes) {
+        size_t bytes = record_size(size);
+        if (offset + bytes > block_size) {
+            ++needed;
+            offset = BLOCK_HEADER_SIZE;
+        }
+        offset += bytes;
+    }
+    return needed;
+}
+
+bool LogStore::commit() {
+    if (staged.empty())
+        return true;
+    if (abort_pending && !write_abort())
+        return false;
+
+    // Make room first, so that garbage collection never happens in the middle of
+    // writing the records of this commit
+    std::vector<size_t> sizes;
+    for (const auto& entry : staged)
+        sizes.push_back(entry.second.data.size());
+    sizes.push_back(0);  // the commit record
+    int attempts = device.block_count();
+    while (blocks_needed(sizes) > free_blocks() - RESERVED_BLOCKS) {
+        if (--attempts < 0 || !collect_garbage()) {
+            log_warning("Log store is full");
+            return false;
+        }
+    }
+
+    std::vector<IndexUpdate> updates;
+    for (const auto& entry : staged) {
+        IndexUpdate update{entry.first, entry.second.removed, {}};
+        const std::vector<uint8_t>& data = entry.second.data;
+        if (!append_record(entry.first, update.removed ? DELETE : DATA, data.data(), data.size(),
+                           &update.location)) {
+            write_abort();
+            return false;
+        }
+        updates.push_back(update);
+    }
+
+    if (!finish_commit(updates)) {
+        write_abort();
+        return false;
+    }
+    staged.clear();
+    return true;
+}
+
+bool LogStore::finish_commit(std::vector<IndexUpdate>& updates) {
+    if (!append_record(0, COMMIT, nullptr, 0, nullptr) || !flush_buffer() || !device.sync())
+        return false;
+
+    for (const IndexUpdate& update : updates)
+        apply(update);
+    return true;
+}
+
+void LogStore::apply(const IndexUpdate& update) {
+    auto existing = index.find(update.key);
+    if (existing != index.end()) {
+        blocks[existing->second.block].live_bytes -= record_size(existing->second.size);
+        index.erase(existing);
+    }
+
+    if (!update.removed) {
+        index[update.key] = update.location;
+        blocks[update.location.block].live_bytes += record_size(update.location.size);
+    }
+}
+
+bool LogStore::append_record(uint16_t key, RecordType type, const uint8_t* data, size_t size,
+                             Location* location) {
+    size_t bytes = record_size(size);
+    if (bytes > device.block_size() - BLOCK_HEADER_SIZE)
+        return false;
+    if (head_block < 0 || head_offset + bytes > device.block_size()) {
+        if (!start_new_block())
+            return false;
+    }
+
+    size_t start = write_buffer.size();
+    ByteWriter out(write_buffer);
+    out.u16(key);
+    out.u8(type);
+    out.u8(0);
+    out.u32((uint32_t)size);
+    out.u32(crc32(data, size, crc32(&write_buffer[start], 8)));
+    out.raw(data, size);
+    while (write_buffer.size() - start < bytes)
+        out.u8(0);
+
+    if (location)
+        *location = {head_block, head_offset, (uint32_t)size};
+    head_offset += bytes;
+    return true;
+}
+
+bool LogStore::flush_buffer() {
+    if (write_buffer.empty())
+        return true;
+
+    // All the records go to the device as one sequential write
+    bool ok = device.program(head_block, buffer_offset, write_buffer.data(), write_buffer.size());
+    write_buffer.clear();
+
+    // A failed write can leave a partially written record, and mounting skips the rest
+    // of the block after one, so nothing more can go in this block
+    if (!ok)
+        head_offset = device.block_size();
+    buffer_offset = head_offset;
+    return ok;
+}
+
+bool LogStore::write_abort() {
+    write_buffer.clear();
+    head_offset = device.block_size();
+    buffer_offset = head_offset;
+    abort_pending =
+        !append_record(0, ABORT, nullptr, 0, nullptr) || !flush_buffer() || !device.sync();
+    return !abort_pending;
+}
+
+bool LogStore::start_new_block() {
+    if (!flush_buffer())
+        return false;
+
+    // Use the blocks in turn so that they wear evenly
+    int count = device.block_count();
+    int block = -1;
+    for (int i = 1; i <= count; ++i) {
+        int candidate = (head_block + i + count) % count;
+        if (!blocks[candidate].in_use) {
+            block = candidate;
+            break;
+        }
+    }
+    if (block < 0)
+        return false;
+
+    if (!blocks[block].erased && !device.erase(block))
+        return false;
+    // Until the header is written, since the block can't be assumed erased if that fails
+    blocks[block].erased = false;
+
+    uint8_t header[BLOCK_HEADER_SIZE];
+    std::vector<uint8_t> bytes;
+    ByteWriter out(bytes);
+    out.u32(BLOCK_MAGIC);
+    out.u32(next_sequence);
+    out.u32(crc32(bytes.data(), 8));
+    std::copy(bytes.begin(), bytes.end(), header);
+    if (!device.program(block, 0, header, sizeof(header)))
+        return false;
+
+    blocks[block].in_use = true;
+    blocks[block].sequence = next_sequence++;
+    blocks[block].live_bytes = 0;
+    head_block = block;
+    head_offset = BLOCK_HEADER_SIZE;
+    buffer_offset = head_offset;
+    return true;
+}
+
+bool LogStore::collect_garbage() {
+    // The oldest block, other than the head
+    int victim = -1;
+    for (int block = 0; block < (int)blocks.size(); ++block) {
+        if (!blocks[block].in_use || block == head_block)
+            continue;
+        if (victim < 0 || blocks[block].sequence < blocks[victim].sequence)
+            victim = block;
+    }
+    if (victim < 0)
+        return false;
+
+    // Copy its live records to the head of the log
+    std::vector<IndexUpdate> updates;
+    std::vector<uint8_t> data;
+    for (const auto& entry : index) {
+        if (entry.second.block != victim)
+            continue;
+        IndexUpdate update{entry.first, false, {}};
+        if (!get(entry.first, data) ||
+            !append_record(entry.first, DATA, data.data(), data.size(), &update.location)) {
+            write_abort();
+            return false;
+        }
+        updates.push_back(update);
+    }
+    if (!updates.empty() && !finish_commit(updates)) {
+        write_abort();
+        return false;
+    }
+
+    if (!device.erase(victim))
+        return false;
+    blocks[victim] = BlockInfo();
+    blocks[victim].erased = true;
+    return true;
+}
+
+bool LogStore::get(uint16_t key, std::vector<uint8_t>& value) const {
+    auto entry = index.find(key);
+    if (entry == index.end())
+        return false;
+
+    const Location& location = entry->second;
+    uint8_t header[RECORD_HEADER_SIZE];
+    value.resize(location.size);
+    if (!device.read(location.block, location.offset, header, sizeof(header)) ||
+        !device.read(location.block, location.offset + RECORD_HEADER_SIZE, value.data(),
+                     location.size))
+        return false;
+
+    ByteReader in(header + 8, 4);
+    if (in.u32() != crc32(value.data(), value.size(), crc32(header, 8))) {
+        log_warning("CRC mismatch for key %d", key);
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint16_t> LogStore::keys() const {
+    std::vector<uint16_t> result;
+    for (const auto& entry : index)
+        result.push_back(entry.first);
+    return result;
+}
+
+size_t LogStore::live_bytes() const {
+    size_t total = 0;
+    for (const BlockInfo& block : blocks)
+        total += block.live_bytes;
+    return total;
+}
+
+int LogStore::free_blocks() const {
+    return std::count_if(blocks.begin(), blocks.end(),
+                         [](const BlockInfo& block) { return !block.in_use; });
+}
@@ -0,0 +1,165 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+// LogStore is a crash-safe key/value store on top of a BlockDevice, meant for projects
+// stored in flash or on an SD card.
+//
+// Everything is written as records appended to a log that moves through the blocks in
+// turn, so blocks are erased evenly and only when they are reclaimed. Each record is
+// CRC checked. Values are staged in RAM by put() and remove(), where repeated updates
+// of the same key coalesce, and are then written by commit() as one sequential write
+// followed by a commit record and a single sync. When mounting, only records followed
+// by a valid commit record are used, so a commit is either completely there or not at
+// all, even if power is lost partway through.
+//
+// When space runs low the oldest block is garbage collected: its live records are
+// copied to the head of the log and the block is erased. A couple of free blocks are
+// always kept in reserve for this.
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "blockDevice.h"
+
+class LogStore {
+   public:
+    static inline constexpr size_t BLOCK_HEADER_SIZE = 12;
+    static inline constexpr size_t RECORD_HEADER_SIZE = 12;
+
+    // Free blocks kept for garbage collection
+    static inline constexpr int RESERVED_BLOCKS = 2;
+
+    explicit LogStore(BlockDevice& block_device) : device(block_device) {}
+
+    // Reads the log and rebuilds the index of keys. If the device holds no log it is
+    // formatted. Returns false if the device can't be read.
+    bool mount();
+
+    // Erases everything
+    bool format();
+
+    // Largest value that can be stored, since a record must fit within a block
+    size_t max_value_size() const;
+
+    // Stages a value to be written by the next commit(). Returns false if the value
+    // is too large.
+    bool put(uint16_t key, const uint8_t* data, size_t size);
+
+    // Stages removal of a key
+    void remove(uint16_t key);
+
+    // Discards everything staged since the last commit
+    void discard_staged();
+
+    // Atomically writes everything that was staged. Returns false if there isn't room,
+    // or the device failed. The staged values are then not visible after mount(),
+    // unless power was lost just as the commit record was written, in which case all of
+    // them are. Either way they are never partly visible. The store can still be used
+    // after a failure, and commits that succeed later are kept.
+    bool commit();
+
+    // Reads the committed value for the key. Returns false if there is no such key or
+    // the data is corrupt.
+    bool get(uint16_t key, std::vector<uint8_t>& value) const;
+
+    bool contains(uint16_t key) const {
+        return index.count(key) != 0;
+    }
+
+    // All committed keys, in order
+    std::vector<uint16_t> keys() const;
+
+    // Bytes of records that are still current
+    size_t live_bytes() const;
+
+    int free_blocks() const;
+
+   private:
+    // ABORT is written when mounting finds an incomplete commit, so that its records are
+    // never mistaken for part of the next commit
+    enum RecordType : uint8_t { DATA = 1, DELETE = 2, COMMIT = 3, ABORT = 4 };
+
+    struct Location {
+        int block;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct BlockInfo {
+        bool in_use = false;
+        // Known to be erased, so can be used without erasing it first
+        bool erased = false;
+        uint32_t sequence = 0;
+        uint32_t live_bytes = 0;
+    };
+
+    // An update that takes effect in the index once its commit record is written
+    struct IndexUpdate {
+        uint16_t key;
+        bool removed;
+        Location location;
+    };
+
+    static size_t record_size(size_t data_size) {
+        // Records are padded to 4 bytes to suit flash with a program granularity
+        return (RECORD_HEADER_SIZE + data_size + 3) & ~(size_t)3;
+    }
+
+    // Scans a block during mount. Returns false if scanning stopped at a corrupt or
+    // partially written record.
+    bool scan_block(int block, std::vector<IndexUpdate>& uncommitted, uint32_t& end_offset);
+
+    // Appends a record to the write buffer, starting a new block if needed
+    bool append_record(uint16_t key, RecordType type, const uint8_t* data, size_t size,
+                       Location* location);
+
+    // Programs the write buffer into the head block. If that fails the head block is
+    // closed, so the next record starts a new block.
+    bool flush_buffer();
+
+    // Called when writing a commit failed partway. Writes an ABORT record in a new
+    // block, so that the records that were written can't be applied by a later commit
+    // record. If that fails too it is retried by the next commit().
+    bool write_abort();
+
+    // Moves the head of the log to a free block
+    bool start_new_block();
+
+    // Number of new blocks needed to append records of the specified data sizes
+    int blocks_needed(const std::vector<size_t>& data_sizes) const;
+
+    // Copies the live records of the oldest block to the head of the log and erases it.
+    // Returns false if there was nothing to collect or the device failed.
+    bool collect_garbage();
+
+    // Writes a commit record, flushes, syncs and then applies the updates to the index
+    bool finish_commit(std::vector<IndexUpdate>& updates);
+
+    void apply(const IndexUpdate& update);
+
+    BlockDevice& device;
+    std::map<uint16_t, Location> index;
+    std::vector<BlockInfo> blocks;
+
+    // Staged values, to be written by commit()
+    struct Staged {
+        bool removed;
+        std::vector<uint8_t> data;
+    };
+    std::map<uint16_t, Staged> staged;
+
+    int head_block = -1;
+    uint32_t head_offset = 0;
+    uint32_t next_sequence = 1;
+
+    // An ABORT record still has to be written before the next commit
+    bool abort_pending = false;
+
+    // Records appended to the head block that haven't been programmed yet
+    std::vector<uint8_t> write_buffer;
+    uint32_t buffer_offset = 0;
+};
+
+#endif  // LOG_STORE_H
@@ -0,0 +1,209 @@
+#include "mappedBank.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../util/byteBuffer.h"
+#define LOG_MODULE_NAME "storage"
+#include "../util/debug.h"
+
+bool BankWriter::add(const std::string& name, BankEntryKind kind, const uint8_t* data,
+                     size_t size) {
+    if (name.size() > MAX_NAME_LENGTH) {
+        log_warning("Bank entry name too long: %s", name.c_str());
+        return false;
+    }
+    for (const Entry& entry : entries) {
+        if (entry.name == name) {
+            log_warning("Bank already has an entry named %s", name.c_str());
+            return false;
+        }
+    }
+
+    entries.push_back({name, kind, std::vector<uint8_t>(data, data + size)});
+    return true;
+}
+
+bool BankWriter::add_pattern(const Pattern& pattern) {
+    uint8_t buffer[Pattern::MAX_SERIALIZED_SIZE];
+    size_t size = pattern.serialize(buffer);
+    return add(pattern.get_name(), BankEntryKind::PATTERN, buffer, size);
+}
+
+static size_t align_up(size_t offset) {
+    return (offset + MappedBank::DATA_ALIGNMENT - 1) & ~(MappedBank::DATA_ALIGNMENT - 1);
+}
+
+bool BankWriter::write(const std::string& path) const {
+    std::vector<const Entry*> sorted;
+    for (const Entry& entry : entries)
+        sorted.push_back(&entry);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Entry* a, const Entry* b) { return a->name < b->name; });
+
+    std::vector<uint8_t> bytes;
+    ByteWriter out(bytes);
+    out.raw(BANK_MAGIC, sizeof(BANK_MAGIC));
+    out.u16(BANK_VERSION);
+    out.u16(0);
+    out.u32((uint32_t)sorted.size());
+    out.u32(0);
+
+    // Index, with the data laid out after it
+    size_t offset = align_up(MappedBank::HEADER_SIZE + sorted.size() * MappedBank::INDEX_ENTRY_SIZE);
+    for (const Entry* entry : sorted) {
+        char name[MappedBank::NAME_SIZE] = {};
+        memcpy(name, entry->name.data(), entry->name.size());
+        out.raw(name, sizeof(name));
+        out.u32((uint32_t)entry->kind);
+        out.u32((uint32_t)entry->data.size());
+        out.u64(offset);
+        offset = align_up(offset + entry->data.size());
+    }
+
+    for (const Entry* entry : sorted) {
+        bytes.resize(align_up(bytes.size()), 0);
+        out.raw(entry->data.data(), entry->data.size());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        log_warning("Could not open %s", path.c_str());
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return (bool)file;
+}
+
+MappedBank::~MappedBank() {
+    close();
+}
+
+bool MappedBank::open(const std::string& path) {
+    close();
+
+#ifdef __unix__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        log_warning("Could not open %s", path.c_str());
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        log_warning("Could not map %s", path.c_str());
+        return false;
+    }
+    // Entries are usually looked up one at a time, so there is no point reading ahead
+    madvise(mapped, info.st_size, MADV_RANDOM);
+    base = static_cast<const uint8_t*>(mapped);
+    length = info.st_size;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        log_warning("Could not open %s", path.c_str());
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (contents.empty())
+        return false;
+    base = contents.data();
+    length = contents.size();
+#endif
+
+    ByteReader in(base + 8, 4);
+    count = length >= HEADER_SIZE ? (int)in.u32() : 0;
+    if (!validate()) {
+        log_warning("%s is not a valid bank", path.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedBank::close() {
+#ifdef __unix__
+    if (base)
+        munmap(const_cast<uint8_t*>(base), length);
+#endif
+    contents.clear();
+    base = nullptr;
+    length = 0;
+    count = 0;
+}
+
+bool MappedBank::validate() const {
+    if (length < HEADER_SIZE || memcmp(base, BANK_MAGIC, sizeof(BANK_MAGIC)) != 0)
+        return false;
+    ByteReader header(base + sizeof(BANK_MAGIC), 2);
+    if (header.u16() != BANK_VERSION)
+        return false;
+    if (count < 0 || (length - HEADER_SIZE) / INDEX_ENTRY_SIZE < (size_t)count)
+        return false;
+
+    for (int entry = 0; entry < count; ++entry) {
+        if (name(entry)[NAME_SIZE - 1] != '\0')
+            return false;
+
+        // find() is a binary search, so needs names in order, and no name twice
+        if (entry > 0 && strcmp(name(entry - 1), name(entry)) >= 0)
+            return false;
+        ByteReader in(index_entry(entry) + NAME_SIZE + 4, 12);
+        uint64_t size = in.u32();
+        uint64_t offset = in.u64();
+        if (offset > length || size > length - offset)
+            return false;
+    }
+    return true;
+}
+
+BankEntryKind MappedBank::kind(int entry) const {
+    ByteReader in(index_entry(entry) + NAME_SIZE, 4);
+    return (BankEntryKind)in.u32();
+}
+
+size_t MappedBank::data_size(int entry) const {
+    ByteReader in(index_entry(entry) + NAME_SIZE + 4, 4);
+    return in.u32();
+}
+
+const uint8_t* MappedBank::data(int entry) const {
+    ByteReader in(index_entry(entry) + NAME_SIZE + 8, 8);
+    return base + in.u64();
+}
+
+int MappedBank::find(const char* entry_name) const {
+    int low = 0;
+    int high = count - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        int order = strncmp(name(middle), entry_name, NAME_SIZE);
+        if (order == 0)
+            return middle;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -1;
+}
+
+bool MappedBank::load_pattern(int entry, Pattern& pattern) const {
+    if (entry < 0 || entry >= count || kind(entry) != BankEntryKind::PATTERN)
+        return false;
+    return pattern.deserialize(data(entry), data_size(entry));
+}
@@ -0,0 +1,118 @@
+#ifndef MAPPED_BANK_H
+#define MAPPED_BANK_H
+
+// A bank is a single read-only file holding many named entries, such as patterns,
+// presets or samples, for the host tools and simulator. The file starts with an index
+// of fixed size entries sorted by name, each giving the kind, size and offset of its
+// data, so any entry can be found with a binary search of the index.
+//
+// MappedBank memory maps the file instead of reading it, so opening a bank of
+// thousands of entries is instant and only the pages that are actually used get read
+// from disk. Entry data is 16 byte aligned within the file, so it can be used in place.
+// Where mmap isn't available the whole file is read instead.
+//
+// BankWriter builds bank files.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../concepts/pattern.h"
+
+// Identifies a bank file, and its version
+inline constexpr char BANK_MAGIC[4] = {'M', 'B', 'N', 'K'};
+inline constexpr uint16_t BANK_VERSION = 1;
+
+// What an entry in a bank holds
+enum class BankEntryKind : uint32_t { PATTERN = 1, PROJECT = 2, PRESET = 3, SAMPLE = 4 };
+
+class BankWriter {
+   public:
+    // Names are stored in fixed size fields, including a terminating null
+    static inline constexpr size_t MAX_NAME_LENGTH = 31;
+
+    // Returns false if the name is too long or already used
+    bool add(const std::string& name, BankEntryKind kind, const uint8_t* data, size_t size);
+
+    // Adds a pattern in its serialized form, under its own name
+    bool add_pattern(const Pattern& pattern);
+
+    int size() const {
+        return (int)entries.size();
+    }
+
+    // Writes the bank, with the index sorted by name
+    bool write(const std::string& path) const;
+
+   private:
+    struct Entry {
+        std::string name;
+        BankEntryKind kind;
+        std::vector<uint8_t> data;
+    };
+    std::vector<Entry> entries;
+};
+
+class MappedBank {
+   public:
+    static inline constexpr size_t HEADER_SIZE = 16;
+    static inline constexpr size_t INDEX_ENTRY_SIZE = 48;
+    static inline constexpr size_t NAME_SIZE = BankWriter::MAX_NAME_LENGTH + 1;
+    static inline constexpr size_t DATA_ALIGNMENT = 16;
+
+    MappedBank() = default;
+    ~MappedBank();
+
+    // Owns the mapping, so can't be copied
+    MappedBank(const MappedBank&) = delete;
+    MappedBank& operator=(const MappedBank&) = delete;
+
+    // Maps the bank file and checks its header and index. Returns false if the file
+    // can't be opened or isn't a valid bank.
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const {
+        return base != nullptr;
+    }
+
+    // Number of entries
+    int size() const {
+        return count;
+    }
+
+    // Entries are in order of name
+    const char* name(int entry) const {
+        return reinterpret_cast<const char*>(index_entry(entry));
+    }
+    BankEntryKind kind(int entry) const;
+    size_t data_size(int entry) const;
+
+    // Points directly into the mapped file, so is valid until the bank is closed
+    const uint8_t* data(int entry) const;
+
+    // Index of the entry with the name, or -1 if there is none
+    int find(const char* entry_name) const;
+
+    // Deserializes a pattern entry. Returns false if the entry isn't a valid pattern.
+    bool load_pattern(int entry, Pattern& pattern) const;
+
+   private:
+    const uint8_t* index_entry(int entry) const {
+        return base + HEADER_SIZE + entry * INDEX_ENTRY_SIZE;
+    }
+
+    // Checks the header, that every entry lies within the file, and that the index is
+    // sorted by name
+    bool validate() const;
+
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    int count = 0;
+
+    // The contents of the file when it can't be mapped
+    std::vector<uint8_t> contents;
+};
+
+#endif  // MAPPED_BANK_H
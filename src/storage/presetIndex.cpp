@@ -0,0 +1,210 @@
+#include "presetIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include "../util/byteBuffer.h"
+#include "../util/crc32.h"
+#define LOG_MODULE_NAME "storage"
+#include "../util/debug.h"
+
+// Compares names ignoring case, up to length characters
+static int compare_names(const char* a, const char* b, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        int difference = tolower((unsigned char)a[i]) - tolower((unsigned char)b[i]);
+        if (difference != 0 || a[i] == '\0')
+            return difference;
+    }
+    return 0;
+}
+
+void PresetIndex::clear() {
+    tags.clear();
+    entries.clear();
+}
+
+uint32_t PresetIndex::tag_bit(const std::string& tag) {
+    uint32_t bit = find_tag(tag);
+    if (bit != 0)
+        return bit;
+
+    if ((int)tags.size() == MAX_TAGS) {
+        log_warning("Too many tags, can't add %s", tag.c_str());
+        return 0;
+    }
+    tags.push_back(tag);
+    return 1u << (tags.size() - 1);
+}
+
+uint32_t PresetIndex::find_tag(const std::string& tag) const {
+    for (size_t i = 0; i < tags.size(); ++i) {
+        if (tags[i] == tag)
+            return 1u << i;
+    }
+    return 0;
+}
+
+int PresetIndex::lower_bound(const char* name) const {
+    auto found = std::lower_bound(entries.begin(), entries.end(), name,
+                                  [](const PresetInfo& info, const char* value) {
+                                      return compare_names(info.name, value, sizeof(info.name)) < 0;
+                                  });
+    return (int)(found - entries.begin());
+}
+
+void PresetIndex::add(const PresetInfo& info) {
+    int position = lower_bound(info.name);
+    if (position < size() && compare_names(entries[position].name, info.name, sizeof(info.name)) == 0)
+        entries[position] = info;
+    else
+        entries.insert(entries.begin() + position, info);
+}
+
+void PresetIndex::add_pattern(const Pattern& pattern, Track::Type track_type, uint32_t tag_mask) {
+    PresetInfo info;
+    snprintf(info.name, sizeof(info.name), "%s", pattern.get_name());
+    info.tags = tag_mask;
+    info.track_type = track_type;
+    info.length = (uint8_t)pattern.get_length();
+
+    uint8_t buffer[Pattern::MAX_SERIALIZED_SIZE];
+    info.hash = crc32(buffer, pattern.serialize(buffer));
+
+    for (int s = 0; s < pattern.get_length(); ++s) {
+        if (pattern.step(s).flags & Step::ACTIVE)
+            info.step_mask |= 1ull << s;
+    }
+
+    add(info);
+}
+
+bool PresetIndex::remove(const char* name) {
+    int position = find(name);
+    if (position < 0)
+        return false;
+    entries.erase(entries.begin() + position);
+    return true;
+}
+
+int PresetIndex::find(const char* name) const {
+    int position = lower_bound(name);
+    if (position < size() &&
+        compare_names(entries[position].name, name, sizeof(PresetInfo::name)) == 0)
+        return position;
+    return -1;
+}
+
+int PresetIndex::find_hash(uint32_t hash) const {
+    for (int i = 0; i < size(); ++i) {
+        if (entries[i].hash == hash)
+            return i;
+    }
+    return -1;
+}
+
+void PresetIndex::search(const char* prefix, uint32_t required_tags,
+                         std::vector<int>& results) const {
+    size_t prefix_length = strlen(prefix);
+    for (int i = lower_bound(prefix); i < size(); ++i) {
+        if (compare_names(entries[i].name, prefix, prefix_length) != 0)
+            break;
+        if ((entries[i].tags & required_tags) == required_tags)
+            results.push_back(i);
+    }
+}
+
+bool PresetIndex::save(const std::string& path) const {
+    std::vector<uint8_t> bytes;
+    ByteWriter out(bytes);
+    out.raw(PRESET_INDEX_MAGIC, sizeof(PRESET_INDEX_MAGIC));
+    out.u16(PRESET_INDEX_VERSION);
+    out.u8((uint8_t)tags.size());
+    for (const std::string& tag : tags)
+        out.str(tag.c_str());
+
+    out.u32((uint32_t)entries.size());
+    for (const PresetInfo& info : entries) {
+        out.raw(info.name, sizeof(info.name));
+        out.u32(info.tags);
+        out.u32(info.hash);
+        out.u64(info.step_mask);
+        out.u8(info.track_type);
+        out.u8(info.length);
+        out.u16(0);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        log_warning("Could not open %s", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+bool PresetIndex::load(const std::string& path) {
+    clear();
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        log_warning("Could not open %s", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        if (size > 0 && fseek(file, 0, SEEK_SET) == 0) {
+            bytes.resize(size);
+            bytes.resize(fread(bytes.data(), 1, bytes.size(), file));
+        }
+    }
+    fclose(file);
+
+    ByteReader in(bytes.data(), bytes.size());
+    const uint8_t* magic = in.raw(sizeof(PRESET_INDEX_MAGIC));
+    if (!magic || memcmp(magic, PRESET_INDEX_MAGIC, sizeof(PRESET_INDEX_MAGIC)) != 0 ||
+        in.u16() != PRESET_INDEX_VERSION) {
+        log_warning("%s is not a preset index", path.c_str());
+        return false;
+    }
+
+    int tag_count = in.u8();
+    for (int i = 0; i < tag_count; ++i)
+        tags.push_back(in.str());
+
+    uint32_t count = in.u32();
+    if (!in.ok() || tag_count > MAX_TAGS || count > in.remaining() / ENTRY_SIZE) {
+        log_warning("%s is truncated", path.c_str());
+        clear();
+        return false;
+    }
+    entries.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        PresetInfo& info = entries[i];
+        memcpy(info.name, in.raw(sizeof(info.name)), sizeof(info.name));
+        info.name[sizeof(info.name) - 1] = '\0';
+        info.tags = in.u32();
+        info.hash = in.u32();
+        info.step_mask = in.u64();
+        uint8_t track_type = in.u8();
+        info.track_type = (Track::Type)track_type;
+        info.length = in.u8();
+        in.u16();
+
+        if (track_type > Track::MODULATION) {
+            log_warning("%s has an invalid track type for %s", path.c_str(), info.name);
+            clear();
+            return false;
+        }
+
+        // Searches are binary searches, so need the names in order, and each only once
+        if (i > 0 && compare_names(entries[i - 1].name, info.name, sizeof(info.name)) >= 0) {
+            log_warning("%s is not sorted by name at %s", path.c_str(), info.name);
+            clear();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+#ifndef PRESET_INDEX_H
+#define PRESET_INDEX_H
+
+// PresetIndex is a summary of a library of presets, so that the browser can show,
+// search and filter them without loading each preset. For each preset it holds the
+// name, tags, track type, length, a hash of the contents and a preview of which steps
+// are active.
+//
+// The index is a single small file that is loaded with one read. Entries are kept
+// sorted by name, ignoring case, so a prefix search is a binary search followed by a
+// scan of just the matching names. Tags are bits in a mask, with up to 32 tag names
+// per index, so filtering by tags is a single AND per preset.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../concepts/pattern.h"
+#include "../concepts/track.h"
+
+// Identifies an index file, and its version
+inline constexpr char PRESET_INDEX_MAGIC[4] = {'M', 'P', 'I', 'X'};
+inline constexpr uint16_t PRESET_INDEX_VERSION = 1;
+
+struct PresetInfo {
+    static inline constexpr size_t MAX_NAME_LENGTH = 31;
+
+    char name[MAX_NAME_LENGTH + 1] = {};
+    uint32_t tags = 0;
+    // For noticing when the preset has changed, or finding duplicates
+    uint32_t hash = 0;
+    // Bit for each active step, for drawing a preview
+    uint64_t step_mask = 0;
+    Track::Type track_type = Track::NOTE;
+    uint8_t length = 0;
+};
+
+class PresetIndex {
+   public:
+    static inline constexpr int MAX_TAGS = 32;
+
+    // Size of each entry in the file
+    static inline constexpr size_t ENTRY_SIZE = PresetInfo::MAX_NAME_LENGTH + 1 + 20;
+
+    // Removes all presets and tags
+    void clear();
+
+    // Mask bit for the tag, adding it if it is new. Returns 0 if there are already
+    // MAX_TAGS tags.
+    uint32_t tag_bit(const std::string& tag);
+
+    // Mask bit for an existing tag, or 0 if there is no such tag
+    uint32_t find_tag(const std::string& tag) const;
+
+    const std::vector<std::string>& tag_names() const {
+        return tags;
+    }
+
+    // Adds or replaces the preset with the same name
+    void add(const PresetInfo& info);
+
+    // Adds or replaces a pattern preset, filling in its summary from the pattern
+    void add_pattern(const Pattern& pattern, Track::Type track_type, uint32_t tag_mask);
+
+    // Removes the preset with the name. Returns false if there is no such preset.
+    bool remove(const char* name);
+
+    int size() const {
+        return (int)entries.size();
+    }
+
+    // Presets are in order of name, ignoring case
+    const PresetInfo& preset(int i) const {
+        return entries[i];
+    }
+
+    // Index of the preset with the name, or -1 if there is none
+    int find(const char* name) const;
+
+    // Index of the first preset with the hash, or -1 if there is none
+    int find_hash(uint32_t hash) const;
+
+    // Finds presets whose names start with prefix, ignoring case, and that have all of
+    // the required tags. An empty prefix matches everything. Appends their indexes, in
+    // order of name, to results.
+    void search(const char* prefix, uint32_t required_tags, std::vector<int>& results) const;
+
+    bool save(const std::string& path) const;
+
+    // Loads an index with a single read. Returns false if the file can't be read or
+    // isn't a valid index, including one with unknown track types or that isn't sorted
+    // by name, in which case the index is left empty.
+    bool load(const std::string& path);
+
+   private:
+    // Position of the first preset not ordered before name
+    int lower_bound(const char* name) const;
+
+    std::vector<std::string> tags;
+    std::vector<PresetInfo> entries;
+};
+
+#endif  // PRESET_INDEX_H
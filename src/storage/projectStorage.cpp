@@ -0,0 +1,124 @@
+#include "projectStorage.h"
+
+#include "../concepts/projectIO.h"
+#define LOG_MODULE_NAME "storage"
+#include "../util/debug.h"
+
+template <typename WriteValue>
+static bool put_value(LogStore& store, uint16_t key, WriteValue&& write_value) {
+    std::vector<uint8_t> bytes;
+    ByteWriter out(bytes);
+    write_value(out);
+    return store.put(key, bytes.data(), bytes.size());
+}
+
+// Version of the binary form that the parts in the store were written with
+static uint8_t stored_version(const LogStore& store) {
+    std::vector<uint8_t> bytes;
+    if (!store.get(VERSION_KEY, bytes) || bytes.empty())
+        return 1;
+    return bytes[0];
+}
+
+bool save_project_changes(LogStore& store, Project& project) {
+    bool ok = true;
+
+    // Parts written by another version are all written again, so that they match
+    if (stored_version(store) != PROJECT_BINARY_VERSION) {
+        project.mark_all_dirty();
+        ok &= put_value(store, VERSION_KEY,
+                        [](ByteWriter& out) { out.u8(PROJECT_BINARY_VERSION); });
+    }
+    if (project.settings_dirty)
+        ok &= put_value(store, SETTINGS_KEY,
+                        [&](ByteWriter& out) { write_project_settings(out, project); });
+
+    for (int track = 0; track < Track::MAX_TRACKS; ++track) {
+        if (project.dirty_tracks & (1u << track))
+            ok &= put_value(store, FIRST_TRACK_KEY + track,
+                            [&](ByteWriter& out) { write_track(out, project.tracks[track]); });
+    }
+
+    int pattern_count = project.patterns.size();
+    if (pattern_count > MAX_STORED_PATTERNS) {
+        log_warning("Too many patterns to save: %d", pattern_count);
+        store.discard_staged();
+        return false;
+    }
+    for (int id = 0; id < pattern_count; ++id) {
+        if (!project.patterns.is_dirty(id))
+            continue;
+        const std::vector<uint8_t>& bytes = project.patterns.serialized_pattern(id);
+        ok &= store.put((uint16_t)(FIRST_PATTERN_KEY + id), bytes.data(), bytes.size());
+    }
+
+    // Patterns that no longer exist
+    for (uint16_t key : store.keys()) {
+        if (key >= FIRST_PATTERN_KEY + pattern_count)
+            store.remove(key);
+    }
+
+    if (project.song_dirty) {
+        // The first key is written even for an empty song, and keys no longer needed
+        // are removed
+        int num_scenes = project.song.num_scenes();
+        for (int part = 0; part < SCENE_KEYS; ++part) {
+            int first = part * SCENES_PER_KEY;
+            uint16_t key = SCENES_KEY + part;
+            if (part == 0 || first < num_scenes)
+                ok &= put_value(store, key, [&](ByteWriter& out) {
+                    write_scenes(out, project.song, first, SCENES_PER_KEY);
+                });
+            else if (store.contains(key))
+                store.remove(key);
+        }
+    }
+
+    if (!ok || !store.commit()) {
+        log_warning("Could not save project changes");
+        store.discard_staged();
+        return false;
+    }
+
+    project.clear_dirty();
+    return true;
+}
+
+bool save_project(LogStore& store, Project& project) {
+    project.mark_all_dirty();
+    return save_project_changes(store, project);
+}
+
+bool load_project(LogStore& store, Project& project) {
+    project.clear();
+
+    std::vector<uint8_t> bytes;
+    if (!store.get(SETTINGS_KEY, bytes))
+        return false;
+    ByteReader settings(bytes.data(), bytes.size());
+    read_project_settings(settings, project);
+
+    for (int track = 0; track < Track::MAX_TRACKS; ++track) {
+        if (!store.get(FIRST_TRACK_KEY + track, bytes))
+            continue;
+        ByteReader in(bytes.data(), bytes.size());
+        read_track(in, project.tracks[track]);
+    }
+
+    for (uint16_t key : store.keys()) {
+        if (key < FIRST_PATTERN_KEY || !store.get(key, bytes))
+            continue;
+        project.patterns.store_serialized(key - FIRST_PATTERN_KEY, bytes.data(), bytes.size());
+    }
+
+    uint8_t version = stored_version(store);
+    for (int part = 0; part < SCENE_KEYS; ++part) {
+        if (!store.get(SCENES_KEY + part, bytes))
+            break;
+        ByteReader in(bytes.data(), bytes.size());
+        append_scenes(in, project.song, version);
+    }
+
+    remove_invalid_pattern_ids(project);
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef PROJECT_STORAGE_H
+#define PROJECT_STORAGE_H
+
+// Saving projects to a LogStore. Each part of the project is a separate key, using the
+// pieces of the binary form from projectIO, so only what changed needs to be written.
+// Everything saved by one call is committed atomically. Changes are found from the
+// project's dirty flags, so a project saved this way must not also use Autosave.
+
+#include "../concepts/project.h"
+#include "logStore.h"
+
+// Keys used for the parts of a project. VERSION_KEY holds the version of the binary
+// form that the parts were written with, and is missing for version 1.
+inline constexpr uint16_t SETTINGS_KEY = 0;
+inline constexpr uint16_t FIRST_TRACK_KEY = 1;
+inline constexpr uint16_t VERSION_KEY = 0xFF;
+inline constexpr uint16_t SCENES_KEY = 0x100;
+inline constexpr uint16_t FIRST_PATTERN_KEY = 0x1000;
+
+// All the scenes don't fit in one value, so they are split across keys from SCENES_KEY
+inline constexpr int SCENES_PER_KEY = 64;
+inline constexpr int SCENE_KEYS = (Song::MAX_SCENES + SCENES_PER_KEY - 1) / SCENES_PER_KEY;
+static_assert(SCENES_KEY + SCENE_KEYS <= FIRST_PATTERN_KEY, "Scene keys must fit");
+
+// Patterns beyond this would run out of keys
+inline constexpr int MAX_STORED_PATTERNS = 0x10000 - FIRST_PATTERN_KEY;
+
+// Saves the parts of the project marked dirty, clearing the dirty flags. Returns false
+// if they couldn't be committed, in which case the dirty flags are left set.
+bool save_project_changes(LogStore& store, Project& project);
+
+// Saves the whole project
+bool save_project(LogStore& store, Project& project);
+
+// Loads the project from a mounted LogStore. Returns false if there is no project.
+bool load_project(LogStore& store, Project& project);
+
+#endif  // PROJECT_STORAGE_H
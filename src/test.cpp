@@ -1,11 +1,12 @@
 #include <iostream>
 #include <thread>
 
-#define DEBUG
+#define LOG_MODULE_NAME "test"
 #include "util/debug.h"
 #include "util/fastRandom.h"
 
 int main() {
+    log_set_level("test", LOG_LEVEL_DEBUG);
     debug("This is a test of the debug macro\n");
 
     for (int i = 0; i < 20; i++) {
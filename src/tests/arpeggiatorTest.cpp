@@ -0,0 +1,110 @@
+// Checks the order the Arpeggiator plays notes in for each mode, and that the
+// arpeggio starts from its first step again once all notes are released.
+
+#include <initializer_list>
+#include <vector>
+
+#include "../seq/arpeggiator.h"
+#include "testUtil.h"
+
+// Ticks the arpeggiator through steps and returns the notes turned on, one per step
+// except in CHORD mode
+static std::vector<int> play(Arpeggiator& arpeggiator, EventQueue& queue, uint32_t& count,
+                             int steps) {
+    std::vector<int> notes;
+    for (int tick = 0; tick < steps * 6; ++tick)
+        arpeggiator.tick(++count);
+
+    NoteEvent event;
+    while (queue.pop(event)) {
+        if (event.type == NoteEvent::NOTE_ON)
+            notes.push_back(event.note);
+    }
+    return notes;
+}
+
+static void hold(Arpeggiator& arpeggiator, std::initializer_list<uint8_t> notes) {
+    for (uint8_t note : notes)
+        arpeggiator.note_on(note, 100);
+}
+
+static void test_modes() {
+    EventQueue queue;
+    Arpeggiator arpeggiator(queue);
+    uint32_t count = 0;
+
+    // Held in a different order than pitch, for AS_PLAYED
+    hold(arpeggiator, {64, 60, 67});
+    CHECK(play(arpeggiator, queue, count, 4) == std::vector<int>({60, 64, 67, 60}));
+
+    arpeggiator.all_notes_off(count);
+    arpeggiator.set_mode(Arpeggiator::DOWN);
+    hold(arpeggiator, {64, 60, 67});
+    CHECK(play(arpeggiator, queue, count, 4) == std::vector<int>({67, 64, 60, 67}));
+
+    arpeggiator.all_notes_off(count);
+    arpeggiator.set_mode(Arpeggiator::UP_DOWN);
+    hold(arpeggiator, {64, 60, 67});
+    CHECK(play(arpeggiator, queue, count, 6) == std::vector<int>({60, 64, 67, 64, 60, 64}));
+
+    arpeggiator.all_notes_off(count);
+    arpeggiator.set_mode(Arpeggiator::AS_PLAYED);
+    hold(arpeggiator, {64, 60, 67});
+    CHECK(play(arpeggiator, queue, count, 3) == std::vector<int>({64, 60, 67}));
+
+    arpeggiator.all_notes_off(count);
+    arpeggiator.set_mode(Arpeggiator::UP).set_octaves(2);
+    hold(arpeggiator, {60, 64});
+    CHECK(play(arpeggiator, queue, count, 5) == std::vector<int>({60, 64, 72, 76, 60}));
+
+    arpeggiator.all_notes_off(count);
+    arpeggiator.set_mode(Arpeggiator::CHORD).set_octaves(1);
+    hold(arpeggiator, {60, 64});
+    CHECK(play(arpeggiator, queue, count, 2) == std::vector<int>({60, 64, 60, 64}));
+}
+
+static void test_restart() {
+    EventQueue queue;
+    Arpeggiator arpeggiator(queue);
+    uint32_t count = 0;
+
+    hold(arpeggiator, {60, 64, 67});
+    CHECK(play(arpeggiator, queue, count, 2) == std::vector<int>({60, 64}));
+
+    // Releasing every note one at a time and pressing new ones starts from the bottom
+    arpeggiator.note_off(60);
+    arpeggiator.note_off(64);
+    arpeggiator.note_off(67);
+    CHECK(arpeggiator.held_count() == 0);
+    play(arpeggiator, queue, count, 3);
+    hold(arpeggiator, {62, 65, 69});
+    CHECK(play(arpeggiator, queue, count, 2) == std::vector<int>({62, 65}));
+
+    // Releasing only some of the notes carries on where the arpeggio was
+    arpeggiator.note_off(62);
+    CHECK(play(arpeggiator, queue, count, 2) == std::vector<int>({65, 69}));
+
+    // all_notes_off() starts from the bottom too
+    arpeggiator.all_notes_off(count);
+    hold(arpeggiator, {48, 52, 55});
+    CHECK(play(arpeggiator, queue, count, 3) == std::vector<int>({48, 52, 55}));
+
+    // RANDOM plays the same steps again, since they depend on the step index
+    arpeggiator.all_notes_off(count);
+    arpeggiator.set_mode(Arpeggiator::RANDOM).set_seed(99);
+    hold(arpeggiator, {60, 62, 64, 65, 67});
+    std::vector<int> first = play(arpeggiator, queue, count, 8);
+    arpeggiator.note_off(60);
+    arpeggiator.note_off(62);
+    arpeggiator.note_off(64);
+    arpeggiator.note_off(65);
+    arpeggiator.note_off(67);
+    hold(arpeggiator, {60, 62, 64, 65, 67});
+    CHECK(play(arpeggiator, queue, count, 8) == first);
+}
+
+int main() {
+    test_modes();
+    test_restart();
+    return test_result();
+}
@@ -0,0 +1,74 @@
+// Checks that AsyncLogRecord packs arguments of each type and formats them the same as
+// printf would, including strings that don't fit in the record, and that the rings of
+// threads that have exited are reused.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../util/asyncLog.h"
+#include "testUtil.h"
+
+template <typename... Args>
+static std::string format_record(const char* format, Args... args) {
+    AsyncLogRecord record{};
+    record.format = format;
+    (record.add(args), ...);
+    char buffer[256];
+    record.format_message(buffer, sizeof(buffer));
+    return buffer;
+}
+
+// Whether the record formats the same as snprintf
+template <typename... Args>
+static bool same_as_printf(const char* format, Args... args) {
+    char expected[256];
+    snprintf(expected, sizeof(expected), format, args...);
+    std::string formatted = format_record(format, args...);
+    if (formatted != expected)
+        fprintf(stderr, "\"%s\" gave \"%s\", expected \"%s\"\n", format, formatted.c_str(),
+                expected);
+    return formatted == expected;
+}
+
+int main() {
+    CHECK(same_as_printf("plain text"));
+    CHECK(same_as_printf("100%%"));
+    CHECK(same_as_printf("%d %i %u", -42, 7, 3000000000u));
+    CHECK(same_as_printf("%x %X %o %5d|%-5d|", 255u, 255u, 8u, 12, 12));
+    CHECK(same_as_printf("%ld %llu %hd", -5000000000L, 18000000000000000000ULL, (short)-3));
+    CHECK(same_as_printf("%c%c", 'o', 'k'));
+    CHECK(same_as_printf("%f %.2f %e %g", 1.5, 3.14159, 12345.678, 0.0001f));
+    CHECK(same_as_printf("%s and %10s|%-4s|", "one", "two", "3"));
+    int value = 0;
+    CHECK(same_as_printf("%p", (void*)&value));
+
+    // Arguments beyond MAX_ARGS are left as their specs
+    CHECK(format_record("%d %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8, 9) ==
+          "1 2 3 4 5 6 7 8 %d");
+
+    // Strings are cut to fit the space left in the record, then are empty
+    std::string long_string(70, 'a');
+    std::string first = std::string(AsyncLogRecord::STRING_BYTES - 1, 'a');
+    CHECK(format_record("%s|%s|%s", long_string.c_str(), "b", "c") == first + "||");
+    std::string almost(62, 'x');
+    CHECK(format_record("%s|%s|%s", almost.c_str(), "yz", "w") == almost + "||");
+
+    AsyncLogRecord record{};
+    record.format = "%s";
+    for (int i = 0; i < AsyncLogRecord::MAX_ARGS; ++i)
+        record.add(long_string.c_str());
+    CHECK(record.strings_used <= AsyncLogRecord::STRING_BYTES);
+    CHECK(record.arg_count == AsyncLogRecord::MAX_ARGS);
+
+    // Many more short lived threads than there are rings
+    uint32_t dropped = async_log_dropped();
+    for (int i = 0; i < 100; ++i) {
+        std::thread([i] { async_log_warning("Thread %d", i); }).join();
+        async_log_flush();
+    }
+    CHECK(async_log_dropped() == dropped);
+
+    return test_result();
+}
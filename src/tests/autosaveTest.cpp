@@ -0,0 +1,170 @@
+// Checks that an Autosave file loads back to the project that was saved, that what
+// power loss can leave at the end of the file, a torn chunk or a run of zeros, only
+// loses the chunk being written rather than the whole file, and that changes collected
+// while writes fail still reach the file once writing works again.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../concepts/projectIO.h"
+#include "../storage/autosave.h"
+#include "testUtil.h"
+
+#ifdef __unix__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const std::string PATH = "autosaveTest.bin";
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)bytes.data(), bytes.size());
+}
+
+static std::vector<uint8_t> to_binary(Project& project) {
+    std::vector<uint8_t> bytes;
+    project_to_binary(project, bytes);
+    return bytes;
+}
+
+// Whether the file loads and gives the expected project
+static bool loads_as(const std::vector<uint8_t>& file, const std::vector<uint8_t>& expected) {
+    write_file(PATH, file);
+    Project loaded;
+    return Autosave::load(PATH, loaded) && to_binary(loaded) == expected;
+}
+
+static void add_pattern(Project& project, int length) {
+    Pattern pattern;
+    pattern.set_length(length);
+    pattern.step(0).flags = Step::ACTIVE;
+    pattern.step(0).note = 60 + length;
+    project.patterns.add(pattern);
+}
+
+static void test_torn_tail() {
+    remove(PATH.c_str());
+
+    Project project;
+    project.name = "Autosave";
+    add_pattern(project, 16);
+
+    // A snapshot followed by one batch of changes
+    Autosave autosave(project, PATH);
+    autosave.start();
+    autosave.collect();
+    project.bpm = 97;
+    project.settings_dirty = true;
+    add_pattern(project, 8);
+    autosave.collect();
+    autosave.wait_until_written();
+    std::vector<uint8_t> good = read_file(PATH);
+    std::vector<uint8_t> good_project = to_binary(project);
+    CHECK(loads_as(good, good_project));
+
+    // One more batch, whose chunks are the tail that power loss can tear
+    project.tracks[3].midi_channel = 9;
+    project.mark_track_dirty(3);
+    add_pattern(project, 4);
+    autosave.collect();
+    autosave.wait_until_written();
+    autosave.stop();
+    std::vector<uint8_t> full = read_file(PATH);
+    CHECK(full.size() > good.size());
+    CHECK(loads_as(full, to_binary(project)));
+    std::vector<uint8_t> tail(full.begin() + good.size(), full.end());
+
+    // Zeros after the end, as a file system can leave after power loss
+    for (size_t zeros : {1, 7, 11, 64, 4096}) {
+        std::vector<uint8_t> file = good;
+        file.resize(good.size() + zeros, 0);
+        CHECK(loads_as(file, good_project));
+    }
+
+    // The new chunks cut off at every length, and the torn part followed by zeros.
+    // Whole chunks before the cut are kept, so what loads is never less than before.
+    for (size_t cut = 0; cut < tail.size(); ++cut) {
+        std::vector<uint8_t> file = good;
+        file.insert(file.end(), tail.begin(), tail.begin() + cut);
+        for (size_t zeros : {0, 64}) {
+            file.resize(good.size() + cut + zeros, 0);
+            write_file(PATH, file);
+            Project loaded;
+            CHECK(Autosave::load(PATH, loaded));
+            CHECK(loaded.bpm == 97 && loaded.patterns.size() >= 2);
+        }
+    }
+    // A tail of zeros as long as the new chunks, as after the file size was updated
+    // but before the data was
+    std::vector<uint8_t> zeroed = good;
+    zeroed.resize(full.size(), 0);
+    CHECK(loads_as(zeroed, good_project));
+
+    // Every byte of the new chunks damaged in turn. Whatever loads is a state the
+    // project was in, and never less than what was there before the chunks.
+    for (size_t i = 0; i < tail.size(); ++i) {
+        std::vector<uint8_t> file = full;
+        file[good.size() + i] ^= 0x5A;
+        write_file(PATH, file);
+        Project loaded;
+        CHECK(Autosave::load(PATH, loaded));
+        CHECK(loaded.bpm == 97 && loaded.patterns.size() >= 2);
+    }
+
+    remove(PATH.c_str());
+}
+
+// Writes fail while the directory for the file is missing
+static void test_failed_writes() {
+#ifdef __unix__
+    const std::string directory = "autosaveTestDir";
+    const std::string path = directory + "/autosave.bin";
+    remove(path.c_str());
+    rmdir(directory.c_str());
+
+    Project project;
+    add_pattern(project, 16);
+    Autosave autosave(project, path);
+    autosave.start();
+
+    // Neither the snapshot nor the changes after it can be written
+    autosave.collect();
+    autosave.wait_until_written();
+    project.bpm = 140;
+    project.settings_dirty = true;
+    add_pattern(project, 8);
+    autosave.collect();
+    autosave.wait_until_written();
+
+    // Once writing works again nothing is missing
+    CHECK(mkdir(directory.c_str(), 0755) == 0);
+    project.tracks[0].midi_channel = 3;
+    project.mark_track_dirty(0);
+    autosave.collect();
+    autosave.wait_until_written();
+    autosave.stop();
+
+    Project loaded;
+    CHECK(Autosave::load(path, loaded));
+    CHECK(to_binary(loaded) == to_binary(project));
+
+    remove(path.c_str());
+    rmdir(directory.c_str());
+#endif
+}
+
+int main() {
+    test_torn_tail();
+    test_failed_writes();
+    return test_result();
+}
@@ -0,0 +1,69 @@
+// Checks the ranges of the FastRandom and FastRandomLanes functions, including that
+// both fill_uniform() versions have the same default range and that max is never
+// returned even when rounding would give it.
+
+#include <vector>
+
+#include "../util/fastRandom.h"
+#include "testUtil.h"
+
+static constexpr size_t COUNT = 10007;
+
+static bool all_within(const std::vector<float>& values, float min, float max) {
+    for (float value : values) {
+        if (!(value >= min && value < max))
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    FastRandom random(1);
+    FastRandomLanes lanes(1);
+    std::vector<float> values(COUNT);
+
+    // Defaults are 0 to 1 for both, and the lanes cover a count that isn't a whole
+    // number of blocks
+    random.fill_uniform(values.data(), COUNT);
+    CHECK(all_within(values, 0.0f, 1.0f));
+    lanes.fill_uniform(values.data(), COUNT);
+    CHECK(all_within(values, 0.0f, 1.0f));
+    float sum = 0.0f;
+    for (float value : values)
+        sum += value;
+    CHECK(sum / COUNT > 0.45f && sum / COUNT < 0.55f);
+
+    random.fill_uniform(values.data(), COUNT, -1.0f, 1.0f);
+    CHECK(all_within(values, -1.0f, 1.0f));
+    lanes.fill_uniform(values.data(), COUNT, -1.0f, 1.0f);
+    CHECK(all_within(values, -1.0f, 1.0f));
+
+    // Noise is bipolar
+    lanes.fill_pink(values.data(), COUNT);
+    sum = 0.0f;
+    for (float value : values)
+        sum += value;
+    CHECK(sum / COUNT > -0.25f && sum / COUNT < 0.25f);
+
+    // Floats near a million are 1/16 apart, so most of the top 1/16 of each range
+    // rounds to max
+    const float min = 1e6f;
+    const float max = 1e6f + 1.0f;
+    bool below_max = true;
+    for (size_t i = 0; i < COUNT; ++i) {
+        float value = random.uniform(min, max);
+        below_max &= value >= min && value < max;
+    }
+    CHECK(below_max);
+    random.fill_uniform(values.data(), COUNT, min, max);
+    CHECK(all_within(values, min, max));
+    lanes.fill_uniform(values.data(), COUNT, min, max);
+    CHECK(all_within(values, min, max));
+
+    std::vector<int32_t> ints(COUNT);
+    random.fill_range(ints.data(), COUNT, -3, 3);
+    for (int32_t value : ints)
+        CHECK(value >= -3 && value <= 3);
+
+    return test_result();
+}
@@ -0,0 +1,73 @@
+// Checks that the crash handler dumps the flight recorder when a thread other than the
+// main one overflows its stack, which needs that thread to have its own alternate
+// signal stack. The crash happens in a child process so the test can watch it.
+
+#include <string>
+#include <thread>
+
+#include "../util/asyncLog.h"
+#include "../util/flightRecorder.h"
+#include "testUtil.h"
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Far deeper than any thread stack. Volatile so the compiler can't tell that the
+// recursion doesn't end.
+static volatile int overflow_depth = 1 << 30;
+
+// The volatile buffer keeps the frames from being optimized away
+static int overflow_stack(int depth) {
+    volatile char frame[1024];
+    frame[0] = (char)depth;
+    if (depth >= overflow_depth)
+        return frame[0];
+    return overflow_stack(depth + 1) + frame[0];
+}
+
+// Runs in the child. A thread that logs asynchronously overflows its stack.
+static void crash_in_thread() {
+    flight_recorder_install_crash_handler();
+    flight_record("before crash", 42);
+    std::thread thread([] {
+        async_log_register_thread();
+        overflow_stack(0);
+    });
+    thread.join();
+}
+
+int main() {
+    int pipe_fds[2];
+    CHECK(pipe(pipe_fds) == 0);
+
+    pid_t child = fork();
+    if (child == 0) {
+        dup2(pipe_fds[1], STDERR_FILENO);
+        close(pipe_fds[0]);
+        crash_in_thread();
+        _exit(0);
+    }
+    close(pipe_fds[1]);
+
+    std::string output;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+        output.append(buffer, length);
+    close(pipe_fds[0]);
+
+    int status = 0;
+    CHECK(waitpid(child, &status, 0) == child);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    CHECK(output.find("Caught signal 11") != std::string::npos);
+    CHECK(output.find("before crash") != std::string::npos);
+
+    return test_result();
+}
+#else
+int main() {
+    // Crash handling is only supported on Linux
+    return 0;
+}
+#endif
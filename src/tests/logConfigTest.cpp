@@ -0,0 +1,115 @@
+// Checks setting log levels with log_configure() and log_load_config(): that valid
+// entries are applied even when others name unknown modules or levels, and that a
+// module registered after the configuration was applied starts at its configured
+// level, with later settings taking precedence over earlier ones for "*".
+
+#define LOG_MODULE_NAME "configTest"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../util/debug.h"
+#include "testUtil.h"
+
+static const std::string PATH = "logConfigTest.conf";
+
+static LogModule other_module("configOther", LOG_LEVEL_WARNING);
+
+static int level_of(const LogModule& module) {
+    return module.current_level.load();
+}
+
+// Modules registered when first used, after the configuration has been applied
+static LogModule& late_module() {
+    static LogModule module("configLate", LOG_LEVEL_WARNING);
+    return module;
+}
+
+static LogModule& late_all_module() {
+    static LogModule module("configLateAll", LOG_LEVEL_WARNING);
+    return module;
+}
+
+static LogModule& late_named_module() {
+    static LogModule module("configLateNamed", LOG_LEVEL_WARNING);
+    return module;
+}
+
+static LogModule& late_overridden_module() {
+    static LogModule module("configLateOverridden", LOG_LEVEL_WARNING);
+    return module;
+}
+
+static void test_configure() {
+    CHECK(log_configure("configTest=info, configOther=ERROR"));
+    CHECK(level_of(log_module) == LOG_LEVEL_INFO);
+    CHECK(level_of(other_module) == LOG_LEVEL_ERROR);
+
+    // Bad levels and entries without a level are skipped, but the rest still applied
+    CHECK(!log_configure("configTest=loud configOther=debug"));
+    CHECK(level_of(log_module) == LOG_LEVEL_INFO);
+    CHECK(level_of(other_module) == LOG_LEVEL_DEBUG);
+    CHECK(!log_configure("configTest configOther=none"));
+    CHECK(level_of(log_module) == LOG_LEVEL_INFO);
+    CHECK(level_of(other_module) == LOG_LEVEL_NONE);
+    CHECK(!log_configure("configTest= configTest=5 =info"));
+    CHECK(level_of(log_module) == LOG_LEVEL_INFO);
+
+    // Unknown modules
+    CHECK(!log_configure("configMissing=debug configTest=warning"));
+    CHECK(level_of(log_module) == LOG_LEVEL_WARNING);
+    CHECK(!log_set_level("configMissing", LOG_LEVEL_DEBUG));
+
+    // Comments, and entries on separate lines
+    CHECK(log_configure("# configTest=error\n  configTest=DeBuG\n\n#\nconfigOther=info"));
+    CHECK(level_of(log_module) == LOG_LEVEL_DEBUG);
+    CHECK(level_of(other_module) == LOG_LEVEL_INFO);
+}
+
+static void test_late_modules() {
+    // Not registered yet, so reported, but still kept for when they are
+    CHECK(!log_configure("configLate=debug configLateNamed=info"));
+    CHECK(level_of(late_module()) == LOG_LEVEL_DEBUG);
+
+    // "*" applies to modules with no later setting of their own
+    CHECK(!log_configure("configLateOverridden=debug *=error configLateNamed=info"));
+    CHECK(level_of(late_all_module()) == LOG_LEVEL_ERROR);
+    CHECK(level_of(late_named_module()) == LOG_LEVEL_INFO);
+    CHECK(level_of(late_overridden_module()) == LOG_LEVEL_ERROR);
+    CHECK(level_of(late_module()) == LOG_LEVEL_ERROR);
+    CHECK(level_of(log_module) == LOG_LEVEL_ERROR);
+
+    // Once registered, a module is found like any other
+    CHECK(log_configure("configLate=info"));
+    CHECK(level_of(late_module()) == LOG_LEVEL_INFO);
+}
+
+static void test_load_config() {
+    {
+        std::ofstream file(PATH);
+        file << "# Levels for the test\nconfigTest=info\nconfigOther=none, configLate=debug\n";
+    }
+    CHECK(log_load_config(PATH));
+    CHECK(level_of(log_module) == LOG_LEVEL_INFO);
+    CHECK(level_of(other_module) == LOG_LEVEL_NONE);
+    CHECK(level_of(late_module()) == LOG_LEVEL_DEBUG);
+
+    {
+        std::ofstream file(PATH);
+        file << "configTest=warning\nconfigOther=chatty\n";
+    }
+    CHECK(!log_load_config(PATH));
+    CHECK(level_of(log_module) == LOG_LEVEL_WARNING);
+    CHECK(level_of(other_module) == LOG_LEVEL_NONE);
+
+    remove(PATH.c_str());
+    CHECK(!log_load_config(PATH));
+}
+
+int main() {
+    test_configure();
+    test_late_modules();
+    test_load_config();
+    return test_result();
+}
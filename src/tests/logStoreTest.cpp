@@ -0,0 +1,152 @@
+// Checks that LogStore commits are atomic when power is lost. A series of commits is
+// run, and each one is repeated with power cut after every possible number of
+// programmed bytes. After each cut the store is remounted and must hold exactly the
+// values from before the commit or exactly those from after it. The store is also
+// used again after a cut without remounting, as happens when a single write fails,
+// and commits acknowledged after that must survive the next mount.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../storage/logStore.h"
+#include "../util/fastRandom.h"
+#include "testUtil.h"
+
+using Values = std::map<uint16_t, std::vector<uint8_t>>;
+
+// Small blocks, so commits cross blocks and garbage collection happens often
+static constexpr int BLOCK_COUNT = 8;
+static constexpr size_t BLOCK_SIZE = 512;
+static constexpr int COMMITS = 24;
+static constexpr int KEYS = 6;
+
+static const std::string PATH = "logStoreTest.bin";
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)bytes.data(), bytes.size());
+}
+
+static Values read_values(LogStore& store) {
+    Values values;
+    for (uint16_t key : store.keys())
+        CHECK(store.get(key, values[key]));
+    return values;
+}
+
+// The changes of one commit: values to put, or empty to remove the key
+static Values make_changes(FastRandom& random) {
+    Values changes;
+    int count = 1 + random.below(3);
+    for (int i = 0; i < count; ++i) {
+        uint16_t key = (uint16_t)random.below(KEYS);
+        std::vector<uint8_t>& data = changes[key];
+        if (random.below(5) != 0)
+            data.resize(1 + random.below(100), (uint8_t)random.next());
+    }
+    return changes;
+}
+
+static void stage(LogStore& store, const Values& changes) {
+    for (const auto& change : changes) {
+        if (change.second.empty())
+            store.remove(change.first);
+        else
+            CHECK(store.put(change.first, change.second.data(), change.second.size()));
+    }
+}
+
+static Values with_changes(Values values, const Values& changes) {
+    for (const auto& change : changes) {
+        if (change.second.empty())
+            values.erase(change.first);
+        else
+            values[change.first] = change.second;
+    }
+    return values;
+}
+
+// Repeats the commit with power cut after each number of bytes, until the commit
+// completes. Returns the number of cuts tried.
+static int test_power_loss(const std::vector<uint8_t>& image, const Values& before,
+                           const Values& changes, const Values& next_changes) {
+    Values after = with_changes(before, changes);
+    for (size_t cut = 0;; ++cut) {
+        write_file(PATH, image);
+        bool lost_power;
+        {
+            FileBlockDevice device(PATH, BLOCK_COUNT, BLOCK_SIZE);
+            LogStore store(device);
+            CHECK(store.mount());
+            stage(store, changes);
+            device.simulate_power_loss_after(cut);
+            bool committed = store.commit();
+            lost_power = !device.has_power();
+            CHECK(committed || lost_power);
+            if (!lost_power)
+                return (int)cut;
+
+            // Carry on as if only that write failed
+            device.restore_power();
+            store.discard_staged();
+            stage(store, next_changes);
+            CHECK(store.commit());
+        }
+
+        FileBlockDevice device(PATH, BLOCK_COUNT, BLOCK_SIZE);
+        LogStore store(device);
+        CHECK(store.mount());
+        Values mounted = read_values(store);
+        bool atomic = mounted == with_changes(before, next_changes) ||
+                      mounted == with_changes(after, next_changes);
+        CHECK(atomic);
+        if (!atomic) {
+            fprintf(stderr, "Power lost after %zu bytes\n", cut);
+            return (int)cut;
+        }
+    }
+}
+
+int main() {
+    remove(PATH.c_str());
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT, BLOCK_SIZE);
+        CHECK(device.is_open());
+        LogStore store(device);
+        CHECK(store.mount());
+    }
+
+    FastRandom random(42);
+    Values values;
+    int cuts = 0;
+    for (int commit = 0; commit < COMMITS; ++commit) {
+        Values changes = make_changes(random);
+        Values next_changes = make_changes(random);
+        std::vector<uint8_t> image = read_file(PATH);
+        cuts += test_power_loss(image, values, changes, next_changes);
+
+        // Move on from the state after a successful commit
+        write_file(PATH, image);
+        FileBlockDevice device(PATH, BLOCK_COUNT, BLOCK_SIZE);
+        LogStore store(device);
+        CHECK(store.mount());
+        stage(store, changes);
+        CHECK(store.commit());
+        values = with_changes(values, changes);
+        CHECK(read_values(store) == values);
+    }
+    printf("%d commits, %d power cuts\n", COMMITS, cuts);
+
+    remove(PATH.c_str());
+    return test_result();
+}
@@ -0,0 +1,119 @@
+// Checks that a bank written by BankWriter opens, and that every entry can be found by
+// name and read back, and that banks that are corrupt are refused when opened: bad
+// headers, entries outside of the file, names without a terminating null, and indexes
+// that aren't sorted by name, which find() would search wrongly.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../storage/mappedBank.h"
+#include "testUtil.h"
+
+static const std::string PATH = "mappedBankTest.bank";
+static const std::string CORRUPT_PATH = "mappedBankTest.corrupt.bank";
+
+static const char* const NAMES[] = {"Lead", "Bass", "Arp", "Drums", "Chords"};
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static uint8_t* index_entry(std::vector<uint8_t>& bytes, int entry) {
+    return bytes.data() + MappedBank::HEADER_SIZE + entry * MappedBank::INDEX_ENTRY_SIZE;
+}
+
+// Whether the bank still opens once written with the change
+static bool opens_changed(const std::vector<uint8_t>& bytes,
+                          void (*change)(std::vector<uint8_t>& bytes)) {
+    std::vector<uint8_t> corrupt = bytes;
+    change(corrupt);
+    write_file(CORRUPT_PATH, corrupt);
+    MappedBank bank;
+    return bank.open(CORRUPT_PATH);
+}
+
+static void test_round_trip() {
+    BankWriter writer;
+    for (const char* name : NAMES)
+        CHECK(writer.add_pattern(Pattern().set_name(name).set_length((int)strlen(name))));
+    CHECK(!writer.add_pattern(Pattern().set_name("Bass")));
+    const uint8_t sample[] = {1, 2, 3};
+    CHECK(writer.add("Kick", BankEntryKind::SAMPLE, sample, sizeof(sample)));
+    CHECK(writer.write(PATH));
+
+    MappedBank bank;
+    CHECK(bank.open(PATH));
+    CHECK(bank.size() == 6);
+    for (int entry = 1; entry < bank.size(); ++entry)
+        CHECK(strcmp(bank.name(entry - 1), bank.name(entry)) < 0);
+
+    for (const char* name : NAMES) {
+        int entry = bank.find(name);
+        Pattern pattern;
+        CHECK(entry >= 0 && bank.load_pattern(entry, pattern));
+        CHECK(strcmp(pattern.get_name(), name) == 0);
+        CHECK(pattern.get_length() == (int)strlen(name));
+        CHECK((reinterpret_cast<uintptr_t>(bank.data(entry)) % MappedBank::DATA_ALIGNMENT) == 0);
+    }
+    int kick = bank.find("Kick");
+    CHECK(kick >= 0 && bank.kind(kick) == BankEntryKind::SAMPLE);
+    CHECK(kick >= 0 && bank.data_size(kick) == sizeof(sample) &&
+          memcmp(bank.data(kick), sample, sizeof(sample)) == 0);
+    Pattern pattern;
+    CHECK(!bank.load_pattern(kick, pattern));
+    CHECK(bank.find("Missing") == -1);
+}
+
+static void test_corrupt() {
+    std::vector<uint8_t> bytes = read_file(PATH);
+    CHECK(opens_changed(bytes, [](std::vector<uint8_t>&) {}));
+
+    // Headers
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) { b[0] = 'X'; }));
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) { b[4] = BANK_VERSION + 1; }));
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) {
+        b.resize(MappedBank::HEADER_SIZE - 1);
+    }));
+
+    // More entries than fit in the file, and data beyond the end of it
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) { b[9] = 0x10; }));
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) { b.resize(b.size() - 1); }));
+
+    // A name without its terminating null
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) {
+        memset(index_entry(b, 2), 'A', MappedBank::NAME_SIZE);
+    }));
+
+    // Index entries swapped, so no longer sorted
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) {
+        uint8_t swapped[MappedBank::INDEX_ENTRY_SIZE];
+        memcpy(swapped, index_entry(b, 1), sizeof(swapped));
+        memcpy(index_entry(b, 1), index_entry(b, 3), sizeof(swapped));
+        memcpy(index_entry(b, 3), swapped, sizeof(swapped));
+    }));
+
+    // Two entries with the same name
+    CHECK(!opens_changed(bytes, [](std::vector<uint8_t>& b) {
+        memcpy(index_entry(b, 4), index_entry(b, 3), MappedBank::NAME_SIZE);
+    }));
+}
+
+int main() {
+    test_round_trip();
+    test_corrupt();
+    remove(PATH.c_str());
+    remove(CORRUPT_PATH.c_str());
+    return test_result();
+}
@@ -0,0 +1,132 @@
+// Checks PatternHistory: undo and redo at the limits of the ring of versions, that
+// recording an edit after an undo discards what could have been redone, and that
+// versions share the chunks of steps that an edit didn't change.
+
+#include "../concepts/patternHistory.h"
+#include "testUtil.h"
+
+static constexpr size_t CHUNK_BYTES = sizeof(Step) * PatternHistory::CHUNK_STEPS;
+
+// Revisions of a pattern told apart by the note of its first step
+static Pattern revision(int note) {
+    Pattern pattern;
+    pattern.step(0).note = (uint8_t)note;
+    return pattern;
+}
+
+static int current_note(const PatternHistory& history) {
+    Pattern pattern;
+    history.current(pattern);
+    return pattern.step(0).note;
+}
+
+static void test_ring_limits() {
+    PatternHistory history(revision(0));
+    CHECK(!history.can_undo() && !history.undo());
+    CHECK(!history.can_redo() && !history.redo());
+
+    // More edits than can be undone, so the oldest versions are dropped
+    const int EDITS = PatternHistory::MAX_DEPTH + 5;
+    for (int note = 1; note <= EDITS; ++note)
+        CHECK(history.record(revision(note)));
+    CHECK(history.size() == PatternHistory::MAX_DEPTH + 1);
+    CHECK(current_note(history) == EDITS);
+
+    for (int i = 0; i < PatternHistory::MAX_DEPTH; ++i)
+        CHECK(history.undo());
+    CHECK(!history.can_undo() && !history.undo());
+    CHECK(current_note(history) == EDITS - PatternHistory::MAX_DEPTH);
+
+    for (int i = 0; i < PatternHistory::MAX_DEPTH; ++i)
+        CHECK(history.redo());
+    CHECK(!history.can_redo() && !history.redo());
+    CHECK(current_note(history) == EDITS);
+
+    // Each version in between is the one recorded, after the ring has wrapped
+    for (int note = EDITS - 1; note >= EDITS - PatternHistory::MAX_DEPTH; --note) {
+        history.undo();
+        CHECK(current_note(history) == note);
+    }
+}
+
+static void test_redo_discarded() {
+    PatternHistory history(revision(0));
+    for (int note = 1; note <= 3; ++note)
+        history.record(revision(note));
+    CHECK(history.undo() && history.undo());
+    CHECK(current_note(history) == 1);
+    CHECK(history.can_redo());
+
+    // An unchanged pattern records nothing, so can still redo
+    CHECK(!history.record(revision(1)));
+    CHECK(history.can_redo());
+
+    CHECK(history.record(revision(10)));
+    CHECK(!history.can_redo() && !history.redo());
+    CHECK(history.size() == 3);
+    CHECK(current_note(history) == 10);
+    CHECK(history.undo() && current_note(history) == 1);
+    CHECK(history.undo() && current_note(history) == 0);
+
+    // Also when the ring is full and has wrapped
+    PatternHistory full(revision(0));
+    for (int note = 1; note <= PatternHistory::MAX_DEPTH + 3; ++note)
+        full.record(revision(note));
+    for (int i = 0; i < 3; ++i)
+        full.undo();
+    int undone_to = current_note(full);
+    CHECK(full.record(revision(100)));
+    CHECK(!full.can_redo());
+    CHECK(full.size() == PatternHistory::MAX_DEPTH + 1 - 3 + 1);
+    CHECK(full.undo() && current_note(full) == undone_to);
+}
+
+static void test_chunk_sharing() {
+    Pattern pattern;
+    pattern.set_name("Shared").set_length(32);
+    PatternHistory history(pattern);
+    CHECK(history.unique_chunk_bytes() == 0);
+
+    // Each edit of a step keeps only the chunk it changed from the version before
+    pattern.step(0).note = 61;
+    history.record(pattern);
+    CHECK(history.unique_chunk_bytes() == CHUNK_BYTES);
+    pattern.step(1).note = 62;
+    history.record(pattern);
+    CHECK(history.unique_chunk_bytes() == 2 * CHUNK_BYTES);
+
+    // Settings other than the steps are not in chunks
+    pattern.set_name("Renamed").set_length(16);
+    history.record(pattern);
+    CHECK(history.unique_chunk_bytes() == 2 * CHUNK_BYTES);
+
+    pattern.step(PatternHistory::CHUNK_STEPS * 5).velocity = 10;
+    history.record(pattern);
+    CHECK(history.unique_chunk_bytes() == 3 * CHUNK_BYTES);
+
+    // Undone versions are whole, settings included
+    Pattern undone;
+    CHECK(history.undo());
+    history.current(undone);
+    Pattern expected = pattern;
+    expected.step(PatternHistory::CHUNK_STEPS * 5).velocity = Step().velocity;
+    CHECK(undone == expected);
+    CHECK(history.undo());
+    history.current(undone);
+    CHECK(undone.get_length() == 32);
+    CHECK(undone.step(1).note == 62);
+
+    while (history.undo()) {
+    }
+    history.current(undone);
+    Pattern initial;
+    initial.set_name("Shared").set_length(32);
+    CHECK(undone == initial);
+}
+
+int main() {
+    test_ring_limits();
+    test_redo_discarded();
+    test_chunk_sharing();
+    return test_result();
+}
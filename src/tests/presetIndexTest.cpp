@@ -0,0 +1,162 @@
+// Checks searching a PresetIndex by name prefix, ignoring case, and by tags, that an
+// index saved and loaded back is the same, and that loading refuses an index with an
+// unknown track type or whose presets aren't sorted by name.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../storage/presetIndex.h"
+#include "testUtil.h"
+
+static const std::string PATH = "presetIndexTest.idx";
+
+struct Preset {
+    const char* name;
+    bool bass;
+    bool dark;
+};
+
+// Added out of order
+static const Preset PRESETS[] = {
+    {"bass drop", true, false}, {"Bassline", true, true}, {"Arp up", false, false},
+    {"arp Down", false, true},  {"Acid", true, true},     {"Chords", false, false},
+    {"B", false, false},
+};
+
+// Offset in the file of the preset, since the presets are at the end of it
+static size_t preset_offset(const std::vector<uint8_t>& bytes, int count, int preset) {
+    return bytes.size() - (count - preset) * PresetIndex::ENTRY_SIZE;
+}
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static void build_index(PresetIndex& index) {
+    uint32_t bass = index.tag_bit("bass");
+    uint32_t dark = index.tag_bit("dark");
+    for (const Preset& preset : PRESETS) {
+        uint32_t tags = (preset.bass ? bass : 0) | (preset.dark ? dark : 0);
+        index.add_pattern(Pattern().set_name(preset.name), Track::NOTE, tags);
+    }
+}
+
+// Names of the presets found by the search
+static std::vector<std::string> search(const PresetIndex& index, const char* prefix,
+                                       uint32_t tags) {
+    std::vector<int> results;
+    index.search(prefix, tags, results);
+    std::vector<std::string> names;
+    for (int i : results)
+        names.push_back(index.preset(i).name);
+    return names;
+}
+
+using Names = std::vector<std::string>;
+
+static void test_search() {
+    PresetIndex index;
+    build_index(index);
+    uint32_t bass = index.find_tag("bass");
+    uint32_t dark = index.find_tag("dark");
+    CHECK(bass != 0 && dark != 0 && bass != dark);
+    CHECK(index.find_tag("bright") == 0);
+
+    // In order of name ignoring case, so "arp Down" before "Arp up"
+    CHECK(search(index, "", 0) ==
+          Names({"Acid", "arp Down", "Arp up", "B", "bass drop", "Bassline", "Chords"}));
+    CHECK(search(index, "ar", 0) == Names({"arp Down", "Arp up"}));
+    CHECK(search(index, "AR", 0) == Names({"arp Down", "Arp up"}));
+    CHECK(search(index, "b", 0) == Names({"B", "bass drop", "Bassline"}));
+    CHECK(search(index, "bass", 0) == Names({"bass drop", "Bassline"}));
+    CHECK(search(index, "bassl", 0) == Names({"Bassline"}));
+    CHECK(search(index, "Chords", 0) == Names({"Chords"}));
+    CHECK(search(index, "Chordsx", 0).empty());
+    CHECK(search(index, "z", 0).empty());
+    CHECK(search(index, "0", 0).empty());
+
+    // Presets need all of the tags
+    CHECK(search(index, "", bass) == Names({"Acid", "bass drop", "Bassline"}));
+    CHECK(search(index, "", dark) == Names({"Acid", "arp Down", "Bassline"}));
+    CHECK(search(index, "", bass | dark) == Names({"Acid", "Bassline"}));
+    CHECK(search(index, "b", bass | dark) == Names({"Bassline"}));
+    CHECK(search(index, "arp", bass).empty());
+
+    CHECK(index.find("BASSLINE") == 5);
+    CHECK(index.remove("bassline") && index.find("Bassline") == -1);
+    CHECK(search(index, "", bass | dark) == Names({"Acid"}));
+}
+
+static void test_save_load() {
+    PresetIndex index;
+    build_index(index);
+    CHECK(index.save(PATH));
+
+    PresetIndex loaded;
+    CHECK(loaded.load(PATH));
+    CHECK(loaded.tag_names() == index.tag_names());
+    CHECK(loaded.size() == index.size());
+    for (int i = 0; i < index.size() && i < loaded.size(); ++i) {
+        CHECK(strcmp(loaded.preset(i).name, index.preset(i).name) == 0);
+        CHECK(loaded.preset(i).tags == index.preset(i).tags);
+        CHECK(loaded.preset(i).hash == index.preset(i).hash);
+    }
+    CHECK(search(loaded, "a", loaded.find_tag("dark")) == Names({"Acid", "arp Down"}));
+}
+
+static void test_invalid() {
+    PresetIndex index;
+    build_index(index);
+    index.add_pattern(Pattern().set_name("Drums"), Track::DRUM, 0);
+    CHECK(index.save(PATH));
+    const std::vector<uint8_t> bytes = read_file(PATH);
+    const int count = index.size();
+    PresetIndex loaded;
+
+    // Track type of the last preset, after its name, tags, hash and step mask
+    std::vector<uint8_t> bad_type = bytes;
+    bad_type[preset_offset(bytes, count, count - 1) + PresetInfo::MAX_NAME_LENGTH + 1 + 16] =
+        Track::MODULATION + 1;
+    write_file(PATH, bad_type);
+    CHECK(!loaded.load(PATH));
+    CHECK(loaded.size() == 0);
+
+    // Two presets swapped
+    std::vector<uint8_t> unsorted = bytes;
+    std::swap_ranges(unsorted.begin() + preset_offset(bytes, count, 1),
+                     unsorted.begin() + preset_offset(bytes, count, 2),
+                     unsorted.begin() + preset_offset(bytes, count, 4));
+    write_file(PATH, unsorted);
+    CHECK(!loaded.load(PATH));
+    CHECK(loaded.size() == 0);
+
+    // The same name twice, differing only in case
+    std::vector<uint8_t> duplicate = bytes;
+    memcpy(&duplicate[preset_offset(bytes, count, 2)], "ARP DOWN", 8);
+    write_file(PATH, duplicate);
+    CHECK(!loaded.load(PATH));
+
+    write_file(PATH, bytes);
+    CHECK(loaded.load(PATH) && loaded.size() == count);
+    CHECK(loaded.preset(loaded.find("Drums")).track_type == Track::DRUM);
+    remove(PATH.c_str());
+}
+
+int main() {
+    test_search();
+    test_save_load();
+    test_invalid();
+    return test_result();
+}
@@ -0,0 +1,204 @@
+// Checks that a project saved in the JSON and binary forms loads back the same, without
+// its patterns marked as changed, that values too large for their fields fail the
+// load, and that the streaming SAX loader accepts and rejects the same JSON documents
+// as project_from_json(), and loads the accepted ones into the same project.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../concepts/projectIO.h"
+#include "../concepts/projectSaxLoader.h"
+#include "testUtil.h"
+
+using json = nlohmann::json;
+
+static std::vector<uint8_t> to_binary(const Project& project) {
+    std::vector<uint8_t> bytes;
+    project_to_binary(project, bytes);
+    return bytes;
+}
+
+static void build_project(Project& project) {
+    project.name = "Loaders";
+    project.bpm = 133;
+    project.song.set_beats_per_bar(3);
+    project.tracks[0].midi_channel = 4;
+    project.tracks[1].muted = true;
+    project.tracks[2].type = Track::MODULATION;
+
+    Pattern pattern;
+    pattern.set_name("Bass").set_length(12).set_step_ticks(3);
+    Step& step = pattern.step(5);
+    step.flags = Step::ACTIVE | Step::ACCENT;
+    step.note = 40;
+    step.offset_ticks = -2;
+    project.patterns.add(pattern);
+    project.patterns.add(Pattern().set_name("Empty"));
+
+    Scene scene;
+    scene.pattern_ids[0] = 1;
+    scene.pattern_ids[3] = 0;
+    scene.length_bars = 4;
+    scene.follow_action = Scene::JUMP;
+    scene.jump_target = 1;
+    project.song.add_scene(scene);
+    project.song.add_scene(Scene());
+}
+
+static bool nothing_dirty(const Project& project) {
+    for (int id = 0; id < project.patterns.size(); ++id) {
+        if (project.patterns.is_dirty(id))
+            return false;
+    }
+    return !project.settings_dirty && project.dirty_tracks == 0 && !project.song_dirty;
+}
+
+static void test_round_trips() {
+    Project project;
+    build_project(project);
+    std::vector<uint8_t> expected = to_binary(project);
+
+    Project from_json;
+    CHECK(project_from_json(project_to_json(project), from_json));
+    CHECK(to_binary(from_json) == expected);
+    CHECK(project_to_json(from_json) == project_to_json(project));
+    CHECK(nothing_dirty(from_json));
+
+    Project from_binary;
+    CHECK(project_from_binary(expected.data(), expected.size(), from_binary));
+    CHECK(to_binary(from_binary) == expected);
+    CHECK(nothing_dirty(from_binary));
+
+    // Through files, and the streaming loader
+    const std::string json_path = "projectIOTest.json";
+    const std::string binary_path = "projectIOTest.bin";
+    Project loaded;
+    CHECK(save_project_json(project, json_path));
+    CHECK(load_project_json(json_path, loaded));
+    CHECK(to_binary(loaded) == expected);
+    CHECK(load_project_json_streaming(json_path, loaded));
+    CHECK(to_binary(loaded) == expected);
+    CHECK(nothing_dirty(loaded));
+    CHECK(save_project_binary(project, binary_path));
+    CHECK(load_project_binary(binary_path, loaded));
+    CHECK(to_binary(loaded) == expected);
+    remove(json_path.c_str());
+    remove(binary_path.c_str());
+
+    // A truncated binary form fails rather than loading part of the project
+    for (size_t size = 0; size < expected.size(); ++size)
+        CHECK(!project_from_binary(expected.data(), size, loaded));
+}
+
+// Loads the text with both loaders. Returns whether they agree, and in ok whether they
+// accepted it.
+static bool loaders_agree(const std::string& text, bool& ok) {
+    Project dom;
+    json data = json::parse(text, nullptr, false);
+    bool dom_ok = !data.is_discarded() && project_from_json(data, dom);
+
+    Project sax;
+    bool sax_ok = project_from_json_text(text.data(), text.size(), sax);
+
+    ok = dom_ok;
+    return dom_ok == sax_ok && to_binary(dom) == to_binary(sax);
+}
+
+static void test_loaders_agree() {
+    Project project;
+    build_project(project);
+    json valid = project_to_json(project);
+
+    bool ok = false;
+    CHECK(loaders_agree(valid.dump(), ok) && ok);
+
+    Project loaded;
+    std::string text = valid.dump();
+    CHECK(project_from_json_text(text.data(), text.size(), loaded));
+    CHECK(to_binary(loaded) == to_binary(project));
+
+    json no_version = valid;
+    no_version.erase("version");
+    CHECK(loaders_agree(no_version.dump(), ok) && !ok);
+
+    json string_version = valid;
+    string_version["version"] = "1";
+    CHECK(loaders_agree(string_version.dump(), ok) && !ok);
+
+    json newer = valid;
+    newer["version"] = PROJECT_JSON_VERSION + 1;
+    CHECK(loaders_agree(newer.dump(), ok) && !ok);
+
+    CHECK(loaders_agree(json::array({valid}).dump(), ok) && !ok);
+    CHECK(loaders_agree("42", ok) && !ok);
+    CHECK(loaders_agree("{\"version\": 1", ok) && !ok);
+
+    for (const char* list : {"tracks", "patterns", "scenes"}) {
+        json missing = valid;
+        missing.erase(list);
+        CHECK(loaders_agree(missing.dump(), ok) && !ok);
+    }
+
+    json scene_without_patterns = valid;
+    scene_without_patterns["scenes"][0].erase("patterns");
+    CHECK(loaders_agree(scene_without_patterns.dump(), ok) && !ok);
+
+    // Unknown keys are skipped, and the order of keys doesn't matter
+    json extra = valid;
+    extra["comment"] = {{"nested", {1, 2, {{"version", 99}}}}};
+    extra["patterns"][0]["color"] = "red";
+    CHECK(loaders_agree(extra.dump(), ok) && ok);
+    std::string reordered = "{\"scenes\": [], \"patterns\": [], \"tracks\": [], \"version\": 1}";
+    CHECK(loaders_agree(reordered, ok) && ok);
+}
+
+// Values just inside and just outside of the range of each field
+static void test_ranges() {
+    Project project;
+    build_project(project);
+    json valid = project_to_json(project);
+
+    struct Case {
+        json::json_pointer field;
+        int inside;
+        int outside;
+    };
+    const Case cases[] = {
+        {json::json_pointer("/bpm"), 65535, 65536},
+        {json::json_pointer("/bpm"), 1, 0},
+        {json::json_pointer("/ppqn"), 65535, 70000},
+        {json::json_pointer("/beats_per_bar"), 255, 256},
+        {json::json_pointer("/tracks/0/channel"), 15, 16},
+        {json::json_pointer("/tracks/0/channel"), 0, -1},
+        {json::json_pointer("/patterns/0/length"), Pattern::MAX_STEPS, Pattern::MAX_STEPS + 1},
+        {json::json_pointer("/patterns/0/step_ticks"), 255, 256},
+        {json::json_pointer("/patterns/0/steps/0/note"), 127, 128},
+        {json::json_pointer("/patterns/0/steps/0/note"), 0, -1},
+        {json::json_pointer("/patterns/0/steps/0/velocity"), 127, 300},
+        {json::json_pointer("/patterns/0/steps/0/gate"), 255, 256},
+        {json::json_pointer("/patterns/0/steps/0/probability"), 100, 101},
+        {json::json_pointer("/patterns/0/steps/0/offset"), -128, -129},
+        {json::json_pointer("/patterns/0/steps/0/flags"), 255, 256},
+        {json::json_pointer("/scenes/0/length_bars"), 255, 256},
+        {json::json_pointer("/scenes/0/repeats"), 255, 512},
+        {json::json_pointer("/scenes/0/jump_target"), 65535, 65536},
+        {json::json_pointer("/scenes/0/patterns/0"), 65535, 65536},
+    };
+    for (const Case& test : cases) {
+        bool ok = false;
+        json inside = valid;
+        inside[test.field] = test.inside;
+        CHECK(loaders_agree(inside.dump(), ok) && ok);
+        json outside = valid;
+        outside[test.field] = test.outside;
+        CHECK(loaders_agree(outside.dump(), ok) && !ok);
+    }
+}
+
+int main() {
+    test_round_trips();
+    test_loaders_agree();
+    test_ranges();
+    return test_result();
+}
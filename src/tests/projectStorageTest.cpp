@@ -0,0 +1,168 @@
+// Checks saving projects to a LogStore: that a song with the most scenes a song can
+// have survives a remount, that scenes no longer in the song are removed when it
+// shrinks, that scenes written by version 1 still load, and that a project with more
+// patterns than there are keys for is refused rather than overwriting other keys.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../concepts/projectIO.h"
+#include "../storage/projectStorage.h"
+#include "testUtil.h"
+
+static constexpr int BLOCK_COUNT = 32;
+
+static const std::string PATH = "projectStorageTest.bin";
+
+static std::vector<uint8_t> to_binary(Project& project) {
+    std::vector<uint8_t> bytes;
+    project_to_binary(project, bytes);
+    return bytes;
+}
+
+// Whether the store, once remounted, holds the project
+static bool stored_as(Project& project) {
+    FileBlockDevice device(PATH, BLOCK_COUNT);
+    LogStore store(device);
+    Project loaded;
+    return store.mount() && load_project(store, loaded) &&
+           to_binary(loaded) == to_binary(project);
+}
+
+static void build_song(Project& project, int num_scenes) {
+    project.song.clear();
+    for (int s = 0; s < num_scenes; ++s) {
+        Scene scene;
+        for (int t = 0; t < Track::MAX_TRACKS; ++t)
+            scene.pattern_ids[t] = (uint16_t)((s + t) % project.patterns.size());
+        scene.length_bars = (uint8_t)(1 + s % 8);
+        scene.follow_action = Scene::JUMP;
+        scene.jump_target = (uint16_t)(num_scenes - 1 - s);
+        project.song.add_scene(scene);
+    }
+    project.song_dirty = true;
+}
+
+static void test_scenes() {
+    remove(PATH.c_str());
+    Project project;
+    project.name = "Scenes";
+    for (int i = 0; i < 4; ++i)
+        project.patterns.add(Pattern().set_length(4 + i));
+
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        CHECK(store.mount());
+
+        build_song(project, Song::MAX_SCENES);
+        CHECK(project.song.num_scenes() == Song::MAX_SCENES);
+        CHECK(save_project(store, project));
+    }
+    CHECK(stored_as(project));
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        Project loaded;
+        CHECK(store.mount() && load_project(store, loaded));
+        CHECK(loaded.song.scene(0).jump_target == Song::MAX_SCENES - 1);
+    }
+
+    // Fewer scenes than fit in the keys already written
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        CHECK(store.mount());
+        build_song(project, SCENES_PER_KEY + 1);
+        CHECK(save_project_changes(store, project));
+        CHECK(!store.contains(SCENES_KEY + 2));
+    }
+    CHECK(stored_as(project));
+
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        CHECK(store.mount());
+        build_song(project, 0);
+        CHECK(save_project_changes(store, project));
+    }
+    CHECK(stored_as(project));
+    remove(PATH.c_str());
+}
+
+// Version 1 had no VERSION_KEY, and 8 bit jump targets
+static void test_version_1() {
+    remove(PATH.c_str());
+    Project project;
+    project.name = "Version 1";
+    project.patterns.add(Pattern());
+    build_song(project, 3);
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        CHECK(store.mount());
+        CHECK(save_project(store, project));
+
+        std::vector<uint8_t> scenes;
+        ByteWriter out(scenes);
+        out.u16(3);
+        for (int s = 0; s < 3; ++s) {
+            const Scene& scene = project.song.scene(s);
+            for (uint16_t id : scene.pattern_ids)
+                out.u16(id);
+            out.u8(scene.length_bars);
+            out.u8(scene.repeats);
+            out.u8(scene.follow_action);
+            out.u8((uint8_t)scene.jump_target);
+        }
+        store.remove(VERSION_KEY);
+        CHECK(store.put(SCENES_KEY, scenes.data(), scenes.size()));
+        CHECK(store.commit());
+    }
+    CHECK(stored_as(project));
+
+    // Saving changes writes everything again in the current version
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        Project loaded;
+        CHECK(store.mount() && load_project(store, loaded));
+        loaded.tracks[1].muted = true;
+        loaded.mark_track_dirty(1);
+        CHECK(save_project_changes(store, loaded));
+        CHECK(store.contains(VERSION_KEY));
+        project.tracks[1].muted = true;
+    }
+    CHECK(stored_as(project));
+    remove(PATH.c_str());
+}
+
+static void test_too_many_patterns() {
+    remove(PATH.c_str());
+    Project project;
+    project.name = "Patterns";
+    project.patterns.add(Pattern());
+    {
+        FileBlockDevice device(PATH, BLOCK_COUNT);
+        LogStore store(device);
+        CHECK(store.mount());
+        CHECK(save_project(store, project));
+
+        // The key of the pattern after the last one would wrap around to the settings
+        Project too_many;
+        too_many.name = "Too many";
+        while (too_many.patterns.size() <= MAX_STORED_PATTERNS)
+            too_many.patterns.add(Pattern());
+        CHECK(!save_project(store, too_many));
+    }
+    CHECK(stored_as(project));
+    remove(PATH.c_str());
+}
+
+int main() {
+    test_scenes();
+    test_version_1();
+    test_too_many_patterns();
+    return test_result();
+}
@@ -0,0 +1,87 @@
+// Checks Quantizer against a brute force search for the nearest note, for every scale
+// and chord mask at every root, including the notes at the octave edges of a scale
+// and at the ends of the MIDI and voltage ranges.
+
+#include <algorithm>
+#include <cmath>
+
+#include "../seq/quantizer.h"
+#include "testUtil.h"
+
+static const uint16_t MASKS[] = {
+    Quantizer::CHROMATIC,        Quantizer::MAJOR,           Quantizer::NATURAL_MINOR,
+    Quantizer::HARMONIC_MINOR,   Quantizer::MELODIC_MINOR,   Quantizer::DORIAN,
+    Quantizer::PHRYGIAN,         Quantizer::LYDIAN,          Quantizer::MIXOLYDIAN,
+    Quantizer::LOCRIAN,          Quantizer::MAJOR_PENTATONIC, Quantizer::MINOR_PENTATONIC,
+    Quantizer::BLUES,            Quantizer::WHOLE_TONE,      Quantizer::MAJOR_TRIAD,
+    Quantizer::MINOR_TRIAD,      Quantizer::DIMINISHED_TRIAD, Quantizer::AUGMENTED_TRIAD,
+    Quantizer::MAJOR_SEVENTH,    Quantizer::MINOR_SEVENTH,   Quantizer::DOMINANT_SEVENTH,
+};
+
+static bool in_scale(int note, uint16_t mask, int root) {
+    int semitone = ((note - root) % 12 + 12) % 12;
+    return mask & (1 << semitone);
+}
+
+// Nearest note in the scale, not limited to the MIDI range. On a tie the lower note.
+static int nearest_note(int note, uint16_t mask, int root) {
+    for (int distance = 0;; ++distance) {
+        if (in_scale(note - distance, mask, root))
+            return note - distance;
+        if (in_scale(note + distance, mask, root))
+            return note + distance;
+    }
+}
+
+static void test_scale(const Quantizer& quantizer, uint16_t mask, int root) {
+    CHECK(quantizer.get_mask() ==
+          (((mask << root) | (mask >> (12 - root))) & Quantizer::ALL_NOTES_MASK));
+
+    // Notes beyond the MIDI range are clamped to it
+    for (int note = 0; note < Quantizer::NUM_NOTES; ++note) {
+        int expected = std::min(std::max(nearest_note(note, mask, root), 0), 127);
+        CHECK(quantizer.quantize_note((uint8_t)note) == expected);
+    }
+
+    // Voltages are only clamped to the table, so snap down past 0V as well
+    for (int note = -60; note <= 120; ++note) {
+        float volts = quantizer.quantize_voltage(note / 12.0f);
+        CHECK(std::fabs(volts - nearest_note(note, mask, root) / 12.0f) < 1e-4f);
+    }
+    CHECK(quantizer.quantize_voltage(-100.0f) == quantizer.quantize_voltage(-5.0f));
+    CHECK(quantizer.quantize_voltage(100.0f) == quantizer.quantize_voltage(10.0f));
+}
+
+int main() {
+    Quantizer quantizer;
+    for (int note = 0; note < Quantizer::NUM_NOTES; ++note)
+        CHECK(quantizer.quantize_note((uint8_t)note) == note);
+
+    for (uint16_t mask : MASKS) {
+        for (int root = 0; root < 12; ++root)
+            test_scale(quantizer.set_scale(mask, root), mask, root);
+    }
+
+    // Snapping across the octave edge of the scale
+    quantizer.set_scale(Quantizer::MAJOR_TRIAD);
+    CHECK(quantizer.quantize_note(10) == 12);
+    CHECK(quantizer.quantize_note(11) == 12);
+    CHECK(quantizer.quantize_note(2) == 0);
+    CHECK(quantizer.quantize_note(127) == 127);
+    quantizer.set_scale(Quantizer::MAJOR_TRIAD, 11);
+    CHECK(quantizer.quantize_note(0) == 0);
+    CHECK(quantizer.quantize_note(12) == 11);
+    CHECK(quantizer.quantize_note(126) == 126);
+
+    // Chord intervals are folded into one octave
+    const int seventh[] = {0, 4, 7, 11};
+    CHECK(quantizer.set_chord(seventh, 4).get_mask() == Quantizer::MAJOR_SEVENTH);
+    const int spread[] = {-12, 16, 19};
+    CHECK(quantizer.set_chord(spread, 3, 2).get_mask() ==
+          Quantizer().set_scale(Quantizer::MAJOR_TRIAD, 2).get_mask());
+
+    // An empty mask means chromatic
+    CHECK(quantizer.set_scale(0).get_mask() == Quantizer::CHROMATIC);
+
+    return test_result();
+}
@@ -0,0 +1,123 @@
+// Checks that the Recorder places notes on the steps and micro-timing expected for
+// quantize strengths of 0, 50 and 100%, with and without swing, including notes near
+// the end of the pattern that belong to its first step, and that what it records is
+// published to the clock thread through the PatternEditChannel.
+
+#include "../seq/recorder.h"
+#include "testUtil.h"
+
+// Tick that recording starts on, so positions in the pattern are ticks after it
+static constexpr uint32_t START = 1000;
+
+// 16 steps of 6 ticks, so the pattern is 96 ticks long
+static constexpr int STEP_TICKS = Pattern::DEFAULT_STEP_TICKS;
+static constexpr int LENGTH_TICKS = Pattern::DEFAULT_LENGTH * STEP_TICKS;
+
+static NoteEvent note_event(NoteEvent::Type type, uint32_t tick, uint8_t note) {
+    NoteEvent event;
+    event.type = type;
+    event.tick = tick;
+    event.note = note;
+    event.velocity = 100;
+    return event;
+}
+
+// Records a single note at the position in the pattern, and returns the step played by
+// the clock thread at step_index
+static Step record_at(int position, int quantize, int swing, int step_index) {
+    PatternEditChannel channel;
+    channel.start(0, Pattern());
+    Recorder recorder(channel);
+    recorder.set_quantize_percent(quantize).set_swing_percent(swing);
+    recorder.start(START);
+    recorder.record(note_event(NoteEvent::NOTE_ON, START + position, 64));
+    recorder.stop(START + position + STEP_TICKS);
+
+    const PatternEditChannel::Version& version = channel.current();
+    CHECK(version.id == 0);
+    CHECK(version.pattern.active_count() == 1);
+    return version.pattern.step(step_index);
+}
+
+static bool placed(const Step& step, int offset_ticks) {
+    return (step.flags & Step::ACTIVE) && step.note == 64 && step.offset_ticks == offset_ticks;
+}
+
+static void test_quantize_strength() {
+    // 2 ticks after step 1
+    CHECK(placed(record_at(STEP_TICKS + 2, 100, 50, 1), 0));
+    CHECK(placed(record_at(STEP_TICKS + 2, 50, 50, 1), 1));
+    CHECK(placed(record_at(STEP_TICKS + 2, 0, 50, 1), 2));
+
+    // 2 ticks before step 1
+    CHECK(placed(record_at(STEP_TICKS - 2, 100, 50, 1), 0));
+    CHECK(placed(record_at(STEP_TICKS - 2, 50, 50, 1), -1));
+    CHECK(placed(record_at(STEP_TICKS - 2, 0, 50, 1), -2));
+}
+
+static void test_swing() {
+    // At 75% every odd step is delayed by half a step, 3 ticks
+    CHECK(placed(record_at(STEP_TICKS + 3, 100, 75, 1), 3));
+    CHECK(placed(record_at(STEP_TICKS, 100, 75, 1), 3));
+    CHECK(placed(record_at(STEP_TICKS + 1, 50, 75, 1), 2));
+    CHECK(placed(record_at(STEP_TICKS + 3, 0, 75, 1), 3));
+
+    // Even steps are not swung
+    CHECK(placed(record_at(2 * STEP_TICKS + 1, 100, 75, 2), 0));
+    CHECK(placed(record_at(2 * STEP_TICKS + 2, 100, 75, 2), 0));
+}
+
+static void test_wrap() {
+    // Just before the end of the pattern is early for its first step
+    CHECK(placed(record_at(LENGTH_TICKS - 2, 100, 50, 0), 0));
+    CHECK(placed(record_at(LENGTH_TICKS - 2, 50, 50, 0), -1));
+    CHECK(placed(record_at(LENGTH_TICKS - 2, 0, 50, 0), -2));
+
+    // Including before recording started, and in later passes through the pattern
+    CHECK(placed(record_at(-2, 100, 50, 0), 0));
+    CHECK(placed(record_at(3 * LENGTH_TICKS - 2, 50, 50, 0), -1));
+
+    // A note held across the end of the pattern keeps its whole length
+    PatternEditChannel channel;
+    channel.start(0, Pattern());
+    Recorder recorder(channel);
+    recorder.start(START);
+    recorder.record(note_event(NoteEvent::NOTE_ON, START + LENGTH_TICKS - STEP_TICKS, 50));
+    recorder.record(note_event(NoteEvent::NOTE_OFF, START + LENGTH_TICKS + STEP_TICKS, 50));
+    const Step& step = channel.current().pattern.step(Pattern::DEFAULT_LENGTH - 1);
+    CHECK((step.flags & Step::ACTIVE) && step.note == 50);
+    CHECK(step.gate_percent == 200);
+}
+
+static void test_replace() {
+    Pattern pattern;
+    for (int s = 0; s < pattern.get_length(); ++s)
+        pattern.step(s).flags = Step::ACTIVE;
+    PatternEditChannel channel;
+    channel.start(0, pattern);
+    Recorder recorder(channel);
+    recorder.set_mode(Recorder::REPLACE);
+
+    // The playhead clears the steps it passes, except the one just recorded into
+    recorder.start(START);
+    for (uint32_t tick = START; tick < START + 3 * STEP_TICKS; ++tick) {
+        recorder.tick(tick);
+        if (tick == START + STEP_TICKS - 1)
+            recorder.record(note_event(NoteEvent::NOTE_ON, tick, 70));
+    }
+    recorder.stop(START + 3 * STEP_TICKS);
+
+    const Pattern& played = channel.current().pattern;
+    CHECK(!(played.step(0).flags & Step::ACTIVE));
+    CHECK((played.step(1).flags & Step::ACTIVE) && played.step(1).note == 70);
+    CHECK(!(played.step(2).flags & Step::ACTIVE));
+    CHECK(played.step(3).flags & Step::ACTIVE);
+}
+
+int main() {
+    test_quantize_strength();
+    test_swing();
+    test_wrap();
+    test_replace();
+    return test_result();
+}
@@ -0,0 +1,275 @@
+// Checks Song scene changes: queued scenes, follow actions and stopping, that the
+// clock thread only ever sees fully materialized patterns of the scene it is playing,
+// and that this holds while the UI thread queues scenes as the clock thread switches.
+// Also that when the UI thread changes the patterns being played the clock thread
+// never sees a partly changed pattern, and does move over to the new versions, and
+// that edits through the edit channel are played as they are published.
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "../concepts/song.h"
+#include "../util/fastRandom.h"
+#include "testUtil.h"
+
+static constexpr int SCENES = 6;
+
+// Every track of every scene plays its own pattern, named after its id
+static void build_song(PatternStore& store, Song& song) {
+    for (int s = 0; s < SCENES; ++s) {
+        Scene scene;
+        for (int t = 0; t < Track::MAX_TRACKS; ++t) {
+            Pattern pattern;
+            char name[16];
+            snprintf(name, sizeof(name), "P%d", s * Track::MAX_TRACKS + t);
+            scene.pattern_ids[t] = store.add(pattern.set_name(name));
+        }
+        scene.follow_action = s + 1 < SCENES ? Scene::NEXT : Scene::FIRST;
+        song.add_scene(scene);
+    }
+    song.set_beats_per_bar(1);
+}
+
+// Whether the current patterns are the ones of the current scene. Tracks whose
+// pattern wasn't materialized in time are allowed to be silent.
+static bool playing_scene(const Song& song, bool allow_silent) {
+    int current = song.get_current_scene();
+    for (int t = 0; t < Track::MAX_TRACKS; ++t) {
+        const Pattern* pattern = song.current_pattern(t);
+        if (current == Song::NO_SCENE) {
+            if (pattern)
+                return false;
+            continue;
+        }
+        if (!pattern) {
+            if (!allow_silent)
+                return false;
+            continue;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "P%d", song.scene(current).pattern_ids[t]);
+        if (strcmp(pattern->get_name(), name) != 0)
+            return false;
+    }
+    return true;
+}
+
+static void test_scene_changes() {
+    PatternStore store;
+    Song song(store);
+    build_song(store, song);
+    uint32_t count = 0;
+
+    CHECK(song.get_current_scene() == Song::NO_SCENE);
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == Song::NO_SCENE);
+
+    song.queue_scene(0);
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == 0);
+    CHECK(playing_scene(song, false));
+
+    // Queueing again replaces the scene queued earlier
+    song.queue_scene(3);
+    song.queue_scene(4);
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == 4);
+    CHECK(playing_scene(song, false));
+    CHECK(store.materialized_count() <= PatternStore::CACHE_SLOTS);
+
+    // Follow actions
+    song.prepare();
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == 5);
+    CHECK(playing_scene(song, false));
+    song.prepare();
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == 0);
+    CHECK(playing_scene(song, false));
+
+    song.queue_stop();
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == Song::NO_SCENE);
+    CHECK(playing_scene(song, false));
+
+    // Clearing while playing stops, and a new song starts from its first bar
+    song.queue_scene(1);
+    song.tick(++count, 1);
+    song.queue_scene(2);
+    song.clear();
+    CHECK(song.get_current_scene() == Song::NO_SCENE);
+    for (int t = 0; t < Track::MAX_TRACKS; ++t)
+        CHECK(!song.current_pattern(t));
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == Song::NO_SCENE);
+
+    // Nothing is left pinned, so all the old patterns can be evicted
+    song.prepare();
+    CHECK(store.materialized_count() == 0);
+
+    build_song(store, song);
+    song.scene(0).length_bars = 2;
+    song.queue_scene(0);
+    song.tick(++count, 1);
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == 0);
+    song.prepare();
+    song.tick(++count, 1);
+    CHECK(song.get_current_scene() == 1);
+}
+
+static void test_threads() {
+    PatternStore store;
+    Song song(store);
+    build_song(store, song);
+    song.queue_scene(0);
+
+    // Every tick is a bar, so the clock thread switches scene as often as it can
+    std::atomic<bool> running{true};
+    int mismatches = 0;
+    std::thread clock_thread([&] {
+        for (uint32_t count = 1; count <= 200000; ++count) {
+            song.tick(count, 1);
+            if (!playing_scene(song, true))
+                ++mismatches;
+        }
+        running = false;
+    });
+
+    FastRandom random(7);
+    while (running) {
+        if (random.below(4) == 0)
+            song.queue_scene(random.below(SCENES));
+        else
+            song.prepare();
+    }
+    clock_thread.join();
+    CHECK(mismatches == 0);
+}
+
+// Every step of a version of the pattern has the same note
+static Pattern pattern_version(uint16_t id, uint8_t version) {
+    Pattern pattern;
+    char name[16];
+    snprintf(name, sizeof(name), "P%d", id);
+    pattern.set_name(name).set_length(Pattern::MAX_STEPS);
+    for (int i = 0; i < Pattern::MAX_STEPS; ++i) {
+        pattern.step(i).flags = Step::ACTIVE;
+        pattern.step(i).note = version;
+    }
+    return pattern;
+}
+
+static bool is_whole_version(const Pattern& pattern) {
+    for (int i = 1; i < Pattern::MAX_STEPS; ++i) {
+        if (pattern.step(i).note != pattern.step(0).note)
+            return false;
+    }
+    return true;
+}
+
+static void test_changes_while_playing() {
+    PatternStore store;
+    Song song(store);
+    build_song(store, song);
+    song.scene(0).follow_action = Scene::LOOP;
+    song.queue_scene(0);
+    song.tick(1, 1);
+    CHECK(playing_scene(song, false));
+
+    std::atomic<bool> running{true};
+    int torn = 0;
+    std::thread clock_thread([&] {
+        for (uint32_t count = 2; running; ++count) {
+            song.tick(count, 1);
+            for (int t = 0; t < Track::MAX_TRACKS; ++t) {
+                const Pattern* pattern = song.current_pattern(t);
+                if (pattern && !is_whole_version(*pattern))
+                    ++torn;
+            }
+        }
+    });
+
+    FastRandom random(11);
+    uint8_t versions[Track::MAX_TRACKS] = {};
+    for (int i = 0; i < 20000; ++i) {
+        int track = random.below(Track::MAX_TRACKS);
+        uint16_t id = song.scene(0).pattern_ids[track];
+        store.store(id, pattern_version(id, ++versions[track]));
+        song.prepare();
+    }
+    running = false;
+    clock_thread.join();
+    CHECK(torn == 0);
+
+    // Once the clock thread catches up it plays the latest versions
+    song.tick(1, 1);
+    CHECK(playing_scene(song, false));
+    for (int t = 0; t < Track::MAX_TRACKS; ++t)
+        CHECK(song.current_pattern(t)->step(0).note == versions[t]);
+
+    song.clear();
+    song.prepare();
+    CHECK(store.materialized_count() == 0);
+}
+
+static void test_edit_channel() {
+    PatternStore store;
+    Song song(store);
+    build_song(store, song);
+    song.scene(0).follow_action = Scene::LOOP;
+    song.queue_scene(0);
+    uint32_t count = 0;
+    song.tick(++count, 1);
+    uint16_t id = song.scene(0).pattern_ids[2];
+    uint16_t other_id = song.scene(0).pattern_ids[5];
+
+    PatternEditChannel* channel = song.edit_pattern(id);
+    CHECK(channel && channel->get_id() == id);
+    CHECK(!song.edit_pattern(PatternStore::NO_PATTERN));
+    channel = song.edit_pattern(id);
+    channel->edit().step(3).flags = Step::ACTIVE;
+
+    // Only published edits are played
+    song.tick(++count, 1);
+    CHECK(!song.current_pattern(2)->step(3).is_active());
+    channel->publish();
+    CHECK(!song.current_pattern(2)->step(3).is_active());
+    song.tick(++count, 1);
+    CHECK(song.current_pattern(2)->step(3).is_active());
+    CHECK(!song.current_pattern(5)->step(3).is_active());
+    CHECK(playing_scene(song, false));
+
+    // Nothing is stored until the edit ends
+    Pattern stored;
+    CHECK(store.load(id, stored) && !stored.step(3).is_active());
+    channel->edit().step(4).flags = Step::ACTIVE;
+    channel->revert();
+    CHECK(!channel->edit().step(4).is_active());
+
+    // Editing another pattern ends the edit, and the clock thread plays the stored version
+    channel = song.edit_pattern(other_id);
+    CHECK(store.load(id, stored) && stored.step(3).is_active());
+    song.tick(++count, 1);
+    CHECK(song.current_pattern(2)->step(3).is_active());
+    CHECK(song.current_pattern(2) == store.find(id));
+    channel->edit().step(0).flags = Step::ACTIVE;
+    channel->publish();
+    song.tick(++count, 1);
+    CHECK(song.current_pattern(5)->step(0).is_active());
+
+    song.end_edit();
+    song.tick(++count, 1);
+    CHECK(song.current_pattern(5) == store.find(other_id));
+    CHECK(song.current_pattern(5)->step(0).is_active());
+}
+
+int main() {
+    test_scene_changes();
+    test_threads();
+    test_changes_while_playing();
+    test_edit_channel();
+    return test_result();
+}
@@ -0,0 +1,29 @@
+// Checks StepRandom against the Philox2x32-10 known-answer vectors from Random123, so
+// that playback stays the same across builds and platforms, and checks its ranges.
+
+#include "../util/fastRandom.h"
+#include "testUtil.h"
+
+int main() {
+    // Counter {step, stream << 16 | n} and key seed. value() is the first output word.
+    CHECK(StepRandom(0, 0).value(0, 0) == 0xff1dae59u);
+    CHECK(StepRandom(0xffffffffu, 0xffff).value(0xffffffffu, 0xffff) == 0x2c3f628bu);
+    CHECK(StepRandom(0x13198a2eu, 0x85a3).value(0x243f6a88u, 0x08d3) == 0xdd7ce038u);
+
+    // Stateless, so the same step always gives the same value
+    StepRandom random(1234, 3);
+    CHECK(random.value(77) == random.value(77));
+    CHECK(random.value(77) != random.value(78));
+    CHECK(random.value(77) != StepRandom(1234, 4).value(77));
+
+    for (uint32_t step = 0; step < 10000; ++step) {
+        int32_t value = random.range(step, -5, 5);
+        CHECK(value >= -5 && value <= 5);
+        float uniform = random.uniform(step);
+        CHECK(uniform >= 0.0f && uniform < 1.0f);
+        CHECK(!random.chance(step, 0));
+        CHECK(random.chance(step, 100));
+    }
+
+    return test_result();
+}
@@ -0,0 +1,26 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+// Minimal checks for the unit test programs. A failed CHECK() prints the condition and
+// carries on, so one run reports every failure. main() returns test_result(), which
+// ctest treats as failed if it isn't 0.
+
+#include <cstdio>
+
+inline int test_failures = 0;
+
+#define CHECK(condition)                                                                 \
+    do {                                                                                 \
+        if (!(condition)) {                                                              \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++test_failures;                                                             \
+        }                                                                                \
+    } while (0)
+
+inline int test_result() {
+    if (test_failures)
+        fprintf(stderr, "%d checks failed\n", test_failures);
+    return test_failures ? 1 : 0;
+}
+
+#endif  // TEST_UTIL_H
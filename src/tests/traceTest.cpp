@@ -0,0 +1,106 @@
+// Checks that spans, instants and counters recorded with the trace macros are written
+// as Chrome trace event JSON, with names for the threads they were recorded on, and
+// that nothing is recorded outside of trace_start() and trace_stop().
+
+// The macros are checked whether or not the build compiles them in
+#define TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "../util/json.hpp"
+#include "../util/trace.h"
+#include "testUtil.h"
+
+using json = nlohmann::json;
+
+static const std::string PATH = "traceTest.json";
+
+// The event with the name and phase, or null if there is none
+static json find_event(const json& events, const std::string& name, const std::string& phase) {
+    for (const json& event : events) {
+        if (event.value("name", "") == name && event.value("ph", "") == phase)
+            return event;
+    }
+    return nullptr;
+}
+
+// Name given to the thread with the tid, or empty if none
+static std::string thread_name(const json& events, const json& tid) {
+    for (const json& event : events) {
+        if (event.value("ph", "") == "M" && event.value("name", "") == "thread_name" &&
+            event["tid"] == tid)
+            return event["args"].value("name", "");
+    }
+    return "";
+}
+
+int main() {
+    trace_instant("before start");
+
+    trace_thread_name("test");
+    trace_start();
+    {
+        trace_scope("span");
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    trace_instant("instant");
+    trace_counter("counter", 42);
+    std::thread worker([] {
+        trace_thread_name("worker");
+        trace_scope("worker span");
+    });
+    worker.join();
+    trace_stop();
+    trace_instant("after stop");
+
+    CHECK(trace_event_count() == 4);
+    CHECK(trace_write_json(PATH));
+
+    std::ifstream file(PATH);
+    json trace = json::parse(file, nullptr, false);
+    CHECK(!trace.is_discarded());
+    const json& events = trace["traceEvents"];
+    CHECK(events.is_array());
+
+    json span = find_event(events, "span", "X");
+    CHECK(span.is_object());
+    if (span.is_object()) {
+        CHECK(span["cat"] == "traceTest.cpp");
+        CHECK(span["ts"].is_number() && span["ts"].get<double>() > 0);
+
+        // Times are in microseconds
+        CHECK(span["dur"].is_number() && span["dur"].get<double>() >= 2000);
+        CHECK(thread_name(events, span["tid"]) == "test");
+    }
+
+    json instant = find_event(events, "instant", "i");
+    CHECK(instant.is_object());
+    if (instant.is_object() && span.is_object()) {
+        CHECK(instant["s"] == "t");
+        CHECK(instant["ts"].get<double>() >=
+              span["ts"].get<double>() + span["dur"].get<double>());
+        CHECK(!instant.contains("dur"));
+    }
+
+    json counter = find_event(events, "counter", "C");
+    CHECK(counter.is_object());
+    if (counter.is_object())
+        CHECK(counter["args"]["value"] == 42);
+
+    json worker_span = find_event(events, "worker span", "X");
+    CHECK(worker_span.is_object());
+    if (worker_span.is_object() && span.is_object()) {
+        CHECK(worker_span["tid"] != span["tid"]);
+        CHECK(thread_name(events, worker_span["tid"]) == "worker");
+    }
+
+    CHECK(find_event(events, "before start", "i").is_null());
+    CHECK(find_event(events, "after stop", "i").is_null());
+
+    remove(PATH.c_str());
+    return test_result();
+}
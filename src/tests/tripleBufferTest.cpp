@@ -0,0 +1,108 @@
+// Checks that TripleBuffer gives the reader the most recently published version, the
+// same one again until something newer is published, and never a version that the
+// writer is still filling in, including while the threads run at the same time.
+
+#include <atomic>
+#include <thread>
+
+#include "../util/tripleBuffer.h"
+#include "testUtil.h"
+
+// Every value of a version is the same, so a torn read shows
+struct Version {
+    static inline constexpr int VALUES = 64;
+
+    uint32_t values[VALUES] = {};
+
+    void set(uint32_t value) {
+        for (uint32_t& v : values)
+            v = value;
+    }
+
+    bool is_whole() const {
+        for (uint32_t v : values) {
+            if (v != values[0])
+                return false;
+        }
+        return true;
+    }
+};
+
+static void test_ordering() {
+    Version initial;
+    initial.set(7);
+    TripleBuffer<Version> buffer(initial);
+
+    // Nothing published yet
+    CHECK(!buffer.has_update());
+    CHECK(buffer.read().values[0] == 7);
+
+    buffer.write_buffer().set(1);
+    CHECK(!buffer.has_update());
+    buffer.publish();
+    CHECK(buffer.has_update());
+    const Version& first = buffer.read();
+    CHECK(first.values[0] == 1);
+
+    // No new data, so the same buffer, unchanged by the writer filling in the next
+    CHECK(!buffer.has_update());
+    buffer.write_buffer().set(2);
+    CHECK(&buffer.read() == &first);
+    CHECK(first.values[0] == 1);
+
+    // Versions the reader didn't get to are skipped
+    buffer.publish();
+    buffer.write_buffer().set(3);
+    buffer.publish();
+    CHECK(buffer.has_update());
+    CHECK(buffer.read().values[0] == 3);
+    CHECK(!buffer.has_update());
+    CHECK(buffer.read().values[0] == 3);
+
+    // The writer never gets the buffer the reader is using
+    for (uint32_t value = 4; value < 20; ++value) {
+        const Version& reading = buffer.read();
+        CHECK(&buffer.write_buffer() != &reading);
+        buffer.write_buffer().set(value);
+        buffer.publish();
+        CHECK(reading.values[0] == value - 1);
+        CHECK(buffer.read().values[0] == value);
+    }
+}
+
+static void test_threads() {
+    TripleBuffer<Version> buffer;
+    constexpr uint32_t VERSIONS = 200000;
+
+    std::atomic<bool> running{true};
+    int torn = 0;
+    int backwards = 0;
+    uint32_t last = 0;
+    std::thread reader([&] {
+        while (running || buffer.has_update()) {
+            const Version& version = buffer.read();
+            if (!version.is_whole())
+                ++torn;
+            if (version.values[0] < last)
+                ++backwards;
+            last = version.values[0];
+        }
+    });
+
+    for (uint32_t value = 1; value <= VERSIONS; ++value) {
+        buffer.write_buffer().set(value);
+        buffer.publish();
+    }
+    running = false;
+    reader.join();
+
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(last == VERSIONS);
+}
+
+int main() {
+    test_ordering();
+    test_threads();
+    return test_result();
+}
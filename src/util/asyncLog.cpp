@@ -0,0 +1,306 @@
+#include "asyncLog.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "flightRecorder.h"
+
+// Longest formatted line. Longer messages are truncated.
+static constexpr size_t MAX_LINE_LENGTH = 256;
+
+// Threads beyond this many can't log asynchronously
+static constexpr int MAX_THREADS = 16;
+
+// How often the writer thread checks for records
+static constexpr std::chrono::milliseconds WRITER_INTERVAL{10};
+
+// Single producer, single consumer ring of records for one thread
+struct AsyncLogRing {
+    static inline constexpr uint32_t CAPACITY = 256;
+
+    AsyncLogRecord records[CAPACITY];
+    // log_thread_index() of the thread
+    unsigned thread_index;
+    // Written by the logging thread
+    std::atomic<uint32_t> tail{0};
+    // Written by the writer
+    std::atomic<uint32_t> head{0};
+};
+
+// A slot's ring is kept when its thread exits, and the slot is reused by a new thread
+// once the writer has taken the records that are left
+enum SlotState : uint8_t { FREE, IN_USE, RELEASED };
+
+static std::atomic<AsyncLogRing*> rings[MAX_THREADS];
+static std::atomic<uint8_t> slot_states[MAX_THREADS];
+static std::atomic<uint32_t> dropped{0};
+
+static thread_local AsyncLogRing* thread_ring = nullptr;
+static thread_local bool thread_has_no_ring = false;
+
+// Only one thread at a time can take records from the rings
+static std::mutex writer_mutex;
+static std::thread writer;
+static std::atomic<bool> stopping{false};
+
+// Releases the thread's slot when the thread exits
+struct AsyncLogSlotRelease {
+    int slot = -1;
+
+    ~AsyncLogSlotRelease() {
+        if (slot >= 0)
+            slot_states[slot].store(RELEASED, std::memory_order_release);
+    }
+};
+
+// Whether the writer has taken all the records of a released slot's ring
+static bool is_drained(int slot) {
+    AsyncLogRing* ring = rings[slot].load(std::memory_order_acquire);
+    return !ring || ring->head.load(std::memory_order_acquire) ==
+                        ring->tail.load(std::memory_order_relaxed);
+}
+
+void async_log_register_thread() {
+    if (thread_ring || thread_has_no_ring)
+        return;
+
+    int slot = 0;
+    for (; slot < MAX_THREADS; ++slot) {
+        uint8_t state = slot_states[slot].load(std::memory_order_acquire);
+        if (state == RELEASED && !is_drained(slot))
+            continue;
+        if (state != IN_USE &&
+            slot_states[slot].compare_exchange_strong(state, IN_USE, std::memory_order_acquire))
+            break;
+    }
+    if (slot == MAX_THREADS) {
+        thread_has_no_ring = true;
+        return;
+    }
+
+    AsyncLogRing* ring = rings[slot].load(std::memory_order_acquire);
+    if (!ring)
+        ring = new AsyncLogRing();
+    ring->thread_index = log_thread_index();
+    rings[slot].store(ring, std::memory_order_release);
+    thread_ring = ring;
+
+    static thread_local AsyncLogSlotRelease release;
+    release.slot = slot;
+
+    // Threads that log asynchronously are the real-time ones, whose crashes matter most
+    flight_recorder_install_thread_stack();
+}
+
+AsyncLogRecord* async_log_begin() {
+    if (!thread_ring) {
+        async_log_register_thread();
+        if (!thread_ring) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    uint32_t tail = thread_ring->tail.load(std::memory_order_relaxed);
+    if (tail - thread_ring->head.load(std::memory_order_acquire) == AsyncLogRing::CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &thread_ring->records[tail % AsyncLogRing::CAPACITY];
+}
+
+void async_log_end() {
+    uint32_t tail = thread_ring->tail.load(std::memory_order_relaxed);
+    thread_ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+uint32_t async_log_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+// Formats one conversion specification, such as "%-6.2f", with the argument
+static int format_arg(char* buffer, size_t size, const char* spec, size_t spec_length,
+                      const AsyncLogRecord& record, int arg) {
+    // The spec without its length modifiers, so the argument can be passed at full size
+    char conversion = spec[spec_length - 1];
+    char format[32];
+    size_t length = 0;
+    bool is_long = false;
+    for (size_t i = 0; i + 1 < spec_length && length < sizeof(format) - 4; ++i) {
+        if (strchr("hlqjzt", spec[i]))
+            is_long |= spec[i] != 'h';
+        else
+            format[length++] = spec[i];
+    }
+
+    // Width or precision from an argument isn't supported
+    if (arg >= record.arg_count || memchr(spec, '*', spec_length))
+        return snprintf(buffer, size, "%.*s", (int)spec_length, spec);
+    uint64_t value = record.args[arg];
+    AsyncLogRecord::ArgType type = record.arg_types[arg];
+
+    switch (conversion) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            format[length++] = 'l';
+            format[length++] = 'l';
+            format[length++] = conversion;
+            format[length] = '\0';
+            // Without a length modifier the argument was an int or smaller
+            if (!is_long)
+                value = strchr("di", conversion) ? (uint64_t)(int64_t)(int32_t)value
+                                                 : (uint64_t)(uint32_t)value;
+            return snprintf(buffer, size, format, (long long)value);
+        case 'c':
+            format[length++] = 'c';
+            format[length] = '\0';
+            return snprintf(buffer, size, format, (int)value);
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            format[length++] = conversion;
+            format[length] = '\0';
+            double as_double;
+            if (type == AsyncLogRecord::DOUBLE)
+                memcpy(&as_double, &value, sizeof(as_double));
+            else
+                as_double = type == AsyncLogRecord::INT ? (double)(int64_t)value : (double)value;
+            return snprintf(buffer, size, format, as_double);
+        }
+        case 's':
+            format[length++] = 's';
+            format[length] = '\0';
+            return snprintf(buffer, size, format,
+                            type == AsyncLogRecord::STRING ? record.strings + value : "<not a string>");
+        case 'p':
+            format[length++] = 'p';
+            format[length] = '\0';
+            return snprintf(buffer, size, format, (void*)(uintptr_t)value);
+        default:
+            return snprintf(buffer, size, "%.*s", (int)spec_length, spec);
+    }
+}
+
+int AsyncLogRecord::format_message(char* buffer, size_t size) const {
+    size_t length = 0;
+    int arg = 0;
+    for (const char* c = format; *c != '\0' && length + 1 < size;) {
+        if (*c != '%') {
+            buffer[length++] = *c++;
+            continue;
+        }
+        if (c[1] == '%') {
+            buffer[length++] = '%';
+            c += 2;
+            continue;
+        }
+
+        // Up to and including the conversion character
+        size_t spec_length = 1;
+        while (c[spec_length] != '\0' && !isalpha((unsigned char)c[spec_length]))
+            ++spec_length;
+        while (c[spec_length] != '\0' && strchr("hlqjzt", c[spec_length]))
+            ++spec_length;
+        if (c[spec_length] == '\0')
+            break;
+        ++spec_length;
+
+        int written = format_arg(buffer + length, size - length, c, spec_length, *this, arg++);
+        length = std::min(length + std::max(written, 0), size - 1);
+        c += spec_length;
+    }
+    buffer[length] = '\0';
+    return (int)length;
+}
+
+// Takes the records from all rings and writes them in time order
+static void drain(std::vector<std::pair<unsigned, AsyncLogRecord>>& records) {
+    records.clear();
+    for (int slot = 0; slot < MAX_THREADS; ++slot) {
+        // Read before the tail, so that if the thread has exited the tail is final
+        uint8_t state = slot_states[slot].load(std::memory_order_acquire);
+        AsyncLogRing* ring = rings[slot].load(std::memory_order_acquire);
+        if (!ring || state == FREE)
+            continue;
+        uint32_t head = ring->head.load(std::memory_order_relaxed);
+        uint32_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head)
+            records.emplace_back(ring->thread_index, ring->records[head % AsyncLogRing::CAPACITY]);
+        ring->head.store(head, std::memory_order_release);
+
+        if (state == RELEASED)
+            slot_states[slot].compare_exchange_strong(state, FREE, std::memory_order_release);
+    }
+
+    std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+        return a.second.timestamp < b.second.timestamp;
+    });
+
+    char line[MAX_LINE_LENGTH];
+    for (const auto& [thread, record] : records) {
+        int length = log_prefix(line, sizeof(line), record.timestamp, record.level, thread,
+                                record.file, record.line, record.function);
+        length += record.format_message(line + length, sizeof(line) - length);
+        length = std::min<int>(length, sizeof(line) - 2);
+        line[length++] = '\n';
+        fwrite(line, 1, length, stderr);
+    }
+}
+
+static void writer_loop() {
+#ifdef __linux__
+    // Only write when nothing else needs the CPU
+    sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+    flight_recorder_install_thread_stack();
+
+    std::vector<std::pair<unsigned, AsyncLogRecord>> records;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            drain(records);
+        }
+        std::this_thread::sleep_for(WRITER_INTERVAL);
+    }
+}
+
+void async_log_start() {
+    if (writer.joinable())
+        return;
+    stopping = false;
+    writer = std::thread(writer_loop);
+}
+
+void async_log_stop() {
+    if (!writer.joinable())
+        return;
+    stopping = true;
+    writer.join();
+    async_log_flush();
+}
+
+void async_log_flush() {
+    std::vector<std::pair<unsigned, AsyncLogRecord>> records;
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    drain(records);
+}
@@ -0,0 +1,168 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+// Asynchronous logging for real-time threads such as the clock thread, where writing
+// to stderr could block and ruin the timing.
+//
+// The async_log_*() macros work like the log macros in debug.h, and are filtered by
+// the same module levels. Instead of formatting, they just copy the format
+// string pointer, a timestamp and the raw arguments into a lock-free ring buffer that
+// belongs to the calling thread. A low priority writer thread, started by
+// async_log_start(), takes the records from all threads, and formats and writes them
+// in time order. If a ring is full the record is dropped rather than waiting.
+//
+// The format string must be a string literal. Arguments can be integers, floating
+// point values, pointers and strings. Strings are copied, up to STRING_BYTES in total
+// per record.
+//
+// Each thread's ring is allocated on its first call. Real-time threads should call
+// async_log_register_thread() when they start so that this doesn't happen later. When
+// a thread exits its ring is reused by a later thread, once the writer has written
+// what was left in it.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "debug.h"
+#include "flightRecorder.h"
+
+struct AsyncLogRecord {
+    static inline constexpr int MAX_ARGS = 8;
+    static inline constexpr size_t STRING_BYTES = 64;
+
+    enum ArgType : uint8_t { INT, UINT, DOUBLE, POINTER, STRING };
+
+    uint64_t timestamp;
+    const char* format;
+    const char* file;
+    const char* function;
+    uint16_t line;
+    uint8_t level;
+    uint8_t arg_count;
+    ArgType arg_types[MAX_ARGS];
+    uint64_t args[MAX_ARGS];
+
+    // Copied strings, each null terminated. String args are offsets into this.
+    char strings[STRING_BYTES];
+    uint8_t strings_used;
+
+    // Strings are cut short to fit, and once the space is used up are added as empty
+    // strings, pointing at the last byte which is then always a terminator
+    void add(const char* value) {
+        if (strings_used >= STRING_BYTES) {
+            add_raw(STRING, STRING_BYTES - 1);
+            return;
+        }
+        size_t length = strnlen(value, STRING_BYTES - 1 - strings_used);
+        memcpy(strings + strings_used, value, length);
+        strings[strings_used + length] = '\0';
+        add_raw(STRING, strings_used);
+        strings_used += length + 1;
+    }
+
+    void add(char* value) {
+        add((const char*)value);
+    }
+
+    template <typename T>
+    void add(T value) {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+                      "Unsupported async log argument");
+        if constexpr (std::is_floating_point_v<T>) {
+            double as_double = value;
+            uint64_t bits;
+            memcpy(&bits, &as_double, sizeof(bits));
+            add_raw(DOUBLE, bits);
+        } else if constexpr (std::is_pointer_v<T>) {
+            add_raw(POINTER, (uintptr_t)value);
+        } else if constexpr (std::is_enum_v<T>) {
+            add_raw(INT, (uint64_t)(int64_t)value);
+        } else if constexpr (std::is_signed_v<T>) {
+            add_raw(INT, (uint64_t)(int64_t)value);
+        } else {
+            add_raw(UINT, (uint64_t)value);
+        }
+    }
+
+    void add_raw(ArgType type, uint64_t value) {
+        if (arg_count == MAX_ARGS)
+            return;
+        arg_types[arg_count] = type;
+        args[arg_count] = value;
+        ++arg_count;
+    }
+
+    // Formats the message, without the line prefix. Returns its length.
+    int format_message(char* buffer, size_t size) const;
+};
+
+// Starts the writer thread
+void async_log_start();
+
+// Writes everything logged so far and stops the writer thread
+void async_log_stop();
+
+// Writes everything logged so far, from the calling thread. Only for non real-time
+// threads.
+void async_log_flush();
+
+// Allocates the calling thread's ring now rather than on its first log call
+void async_log_register_thread();
+
+// Number of records dropped because a ring was full or there were too many threads
+uint32_t async_log_dropped();
+
+// Reserves a record in the calling thread's ring, or returns nullptr if it is full.
+// Used by the macros below rather than called directly.
+AsyncLogRecord* async_log_begin();
+void async_log_end();
+
+// Only so that the compiler checks the arguments against the format
+inline void async_log_check_format(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void async_log_check_format(const char*, ...) {}
+
+template <typename... Args>
+void async_log_write(int level, const char* file, int line, const char* function,
+                     const char* format, Args... args) {
+    // Kept even if the ring is full
+    if (level <= LOG_LEVEL_WARNING)
+        flight_record_event(format, file, level);
+
+    AsyncLogRecord* record = async_log_begin();
+    if (!record)
+        return;
+
+    record->timestamp = log_timestamp();
+    record->format = format;
+    record->file = file;
+    record->function = function;
+    record->line = (uint16_t)line;
+    record->level = (uint8_t)level;
+    record->arg_count = 0;
+    record->strings_used = 0;
+    (record->add(args), ...);
+
+    async_log_end();
+}
+
+#define async_log_at(level, fmt, ...)                                                    \
+    do {                                                                                 \
+        if constexpr ((level) <= LOG_LEVEL) {                                            \
+            if (false)                                                                   \
+                async_log_check_format(fmt, ##__VA_ARGS__);                              \
+            if (LOG_CURRENT_MODULE.enabled(level)) {                                     \
+                static constexpr const char* log_file = log_basename(__FILE__);          \
+                async_log_write(level, log_file, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+            }                                                                            \
+        }                                                                                \
+    } while (0)
+
+#define async_log_error(fmt, ...) async_log_at(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define async_log_warning(fmt, ...) async_log_at(LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
+#define async_log_info(fmt, ...) async_log_at(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define async_log_debug(fmt, ...) async_log_at(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#endif  // ASYNC_LOG_H
@@ -0,0 +1,151 @@
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+// Helpers for reading and writing compact little endian binary data, as used by the
+// binary project format and on-device storage.
+//
+// ByteReader never reads past the end of its data. Instead, once a read fails all
+// further reads return zeros and ok() returns false, so a whole record can be read
+// and then checked just once.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class ByteWriter {
+   public:
+    ByteWriter(std::vector<uint8_t>& output) : bytes(output) {}
+
+    void u8(uint8_t value) {
+        bytes.push_back(value);
+    }
+
+    void u16(uint16_t value) {
+        u8((uint8_t)value);
+        u8((uint8_t)(value >> 8));
+    }
+
+    void u32(uint32_t value) {
+        u16((uint16_t)value);
+        u16((uint16_t)(value >> 16));
+    }
+
+    void u64(uint64_t value) {
+        u32((uint32_t)value);
+        u32((uint32_t)(value >> 32));
+    }
+
+    void raw(const void* data, size_t size) {
+        const uint8_t* start = static_cast<const uint8_t*>(data);
+        bytes.insert(bytes.end(), start, start + size);
+    }
+
+    // String of up to 255 characters, preceded by its length
+    void str(const char* value) {
+        size_t length = std::min<size_t>(std::strlen(value), 255);
+        u8((uint8_t)length);
+        raw(value, length);
+    }
+
+    // Block of bytes preceded by its 16 bit length
+    void block(const uint8_t* data, size_t size) {
+        u16((uint16_t)size);
+        raw(data, size);
+    }
+
+    size_t size() const {
+        return bytes.size();
+    }
+
+   private:
+    std::vector<uint8_t>& bytes;
+};
+
+class ByteReader {
+   public:
+    ByteReader(const uint8_t* data, size_t size) : next(data), end(data + size) {}
+
+    bool ok() const {
+        return !failed;
+    }
+
+    size_t remaining() const {
+        return end - next;
+    }
+
+    uint8_t u8() {
+        if (!available(1))
+            return 0;
+        return *next++;
+    }
+
+    uint16_t u16() {
+        uint16_t low = u8();
+        return low | (uint16_t)(u8() << 8);
+    }
+
+    uint32_t u32() {
+        uint32_t low = u16();
+        return low | ((uint32_t)u16() << 16);
+    }
+
+    uint64_t u64() {
+        uint64_t low = u32();
+        return low | ((uint64_t)u32() << 32);
+    }
+
+    // Returns pointer to the next size bytes and skips over them, or nullptr if there
+    // aren't that many
+    const uint8_t* raw(size_t size) {
+        if (!available(size))
+            return nullptr;
+        const uint8_t* start = next;
+        next += size;
+        return start;
+    }
+
+    // Reads a string written by ByteWriter::str() into buffer of buffer_size, always
+    // null terminating it
+    void str(char* buffer, size_t buffer_size) {
+        size_t length = u8();
+        const uint8_t* data = raw(length);
+        size_t copied = data ? std::min(length, buffer_size - 1) : 0;
+        if (copied)
+            std::memcpy(buffer, data, copied);
+        buffer[copied] = '\0';
+    }
+
+    std::string str() {
+        size_t length = u8();
+        const uint8_t* data = raw(length);
+        return data ? std::string((const char*)data, length) : std::string();
+    }
+
+    // Reads a block written by ByteWriter::block(). Sets size and returns pointer to
+    // the data, or nullptr if truncated.
+    const uint8_t* block(size_t& size) {
+        size = u16();
+        const uint8_t* data = raw(size);
+        if (!data)
+            size = 0;
+        return data;
+    }
+
+   private:
+    bool available(size_t size) {
+        if (failed || (size_t)(end - next) < size) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* next;
+    const uint8_t* end;
+    bool failed = false;
+};
+
+#endif  // BYTE_BUFFER_H
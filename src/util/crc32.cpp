@@ -0,0 +1,25 @@
+#include "crc32.h"
+
+// Table for the reflected polynomial 0xEDB88320, generated at compile time
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            entries[i] = value;
+        }
+    }
+};
+
+static constexpr Crc32Table CRC32_TABLE;
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = CRC32_TABLE.entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
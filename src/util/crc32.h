@@ -0,0 +1,14 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+// Standard CRC-32 (as used by zip and ethernet) for detecting corrupted or partially
+// written data.
+
+#include <cstddef>
+#include <cstdint>
+
+// Returns the CRC of the data. To compute the CRC of data in pieces, pass the result
+// for the previous pieces as crc.
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+#endif  // CRC32_H
@@ -1,32 +1,198 @@
 #include "debug.h"
 
 #include <algorithm>
-#include <chrono>
-#include <iostream>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
 #include <string>
-#include <thread>
+#include <utility>
+#include <vector>
 
+#include "flightRecorder.h"
+
+using namespace std::chrono;
+
+// Store start time for application
+const steady_clock::time_point g_start_time = steady_clock::now();
+
+std::atomic<unsigned> g_next_thread_index{0};
+
+// Head of the list of registered modules. Constant initialized, so modules can
+// register from static constructors in any translation unit.
+static std::atomic<LogModule*> g_first_log_module{nullptr};
+
+#ifdef DEBUG
+LogModule g_default_log_module("default", LOG_LEVEL_DEBUG);
+#else
+LogModule g_default_log_module("default", LOG_DEFAULT_LEVEL);
+#endif
+
+// Levels set so far by name, in the order they were set, so that a module registered
+// afterwards, such as a function local static, still gets its configured level. Setting
+// "*" replaces them all.
+static std::mutex g_log_settings_mutex;
+
+static std::vector<std::pair<std::string, int>>& log_settings() {
+    static std::vector<std::pair<std::string, int>> settings;
+    return settings;
+}
+
+// Level set for modules with the name, or -1 if none has been. Needs the settings mutex.
+static int configured_level(const char* name) {
+    int level = -1;
+    for (const auto& [setting_name, setting_level] : log_settings()) {
+        if (setting_name == name || setting_name == "*")
+            level = setting_level;
+    }
+    return level;
+}
+
+LogModule::LogModule(const char* module_name, int initial_level)
+    : name(module_name), current_level(initial_level) {
+    // Modules are never removed, so pushing onto the front is all that is needed
+    next = g_first_log_module.load(std::memory_order_relaxed);
+    while (!g_first_log_module.compare_exchange_weak(next, this, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+    }
+
+    // After being pushed, so a level set at the same time is either found here or
+    // applied to this module by log_set_level()
+    std::lock_guard<std::mutex> lock(g_log_settings_mutex);
+    int level = configured_level(module_name);
+    if (level >= 0)
+        current_level.store(level, std::memory_order_relaxed);
+}
+
+LogModule* log_first_module() {
+    return g_first_log_module.load(std::memory_order_acquire);
+}
+
+bool log_set_level(const char* name, int level) {
+    level = std::clamp(level, LOG_LEVEL_NONE, LOG_LEVEL_DEBUG);
+    bool all = strcmp(name, "*") == 0;
+
+    std::lock_guard<std::mutex> lock(g_log_settings_mutex);
+    auto& settings = log_settings();
+    if (all) {
+        settings.clear();
+    } else {
+        settings.erase(std::remove_if(settings.begin(), settings.end(),
+                                      [name](const auto& setting) { return setting.first == name; }),
+                       settings.end());
+    }
+    settings.emplace_back(name, level);
+
+    bool found = false;
+    for (LogModule* module = log_first_module(); module; module = module->next) {
+        if (all || strcmp(module->name, name) == 0) {
+            module->current_level.store(level, std::memory_order_relaxed);
+            found = true;
+        }
+    }
+    return found;
+}
+
+static const char* const LEVEL_NAMES[] = {"NONE", "ERROR", "WARNING", "INFO", "DEBUG"};
+
+int log_level_from_name(const char* name) {
+    for (int level = LOG_LEVEL_NONE; level <= LOG_LEVEL_DEBUG; ++level) {
+        const char* level_name = LEVEL_NAMES[level];
+        size_t i = 0;
+        while (name[i] && tolower((unsigned char)name[i]) == tolower((unsigned char)level_name[i]))
+            ++i;
+        if (!name[i] && !level_name[i])
+            return level;
+    }
+    return -1;
+}
+
+bool log_configure(const char* settings) {
+    bool ok = true;
+    const char* p = settings;
+    while (*p) {
+        if (isspace((unsigned char)*p) || *p == ',') {
+            ++p;
+            continue;
+        }
+        if (*p == '#') {
+            while (*p && *p != '\n')
+                ++p;
+            continue;
+        }
+
+        const char* start = p;
+        while (*p && !isspace((unsigned char)*p) && *p != ',')
+            ++p;
+        std::string entry(start, p);
+
+        size_t equals = entry.find('=');
+        int level = equals == std::string::npos ? -1
+                                                : log_level_from_name(entry.c_str() + equals + 1);
+        if (level < 0) {
+            log_warning("Invalid log setting %s", entry.c_str());
+            ok = false;
+            continue;
+        }
+        std::string name = entry.substr(0, equals);
+        if (!log_set_level(name.c_str(), level)) {
+            log_warning("No log module named %s yet", name.c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool log_load_config(const std::string& path) {
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::string settings((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return log_configure(settings.c_str());
+}
 
 std::string thread_id() {
-    // Yes, getting thread ID as a string is this complicated in C++.
-    std::ostringstream ss;
-    ss << std::this_thread::get_id();
-    return ss.str();
+    return std::to_string(log_thread_index());
 }
 
 std::string short_thread_id() {
-    // Jusr return last 6 characters of thread ID.
-    int MAX_LENGTH = 6;
-    std::string id = thread_id();
-    return id.substr(std::max((int) id.size() - MAX_LENGTH, 0));
+    return thread_id();
 }
 
-// Store start time for application
-using namespace std::chrono;
-auto g_start_time = steady_clock::now();
-
 std::string time_str() {
-    nanoseconds duration = steady_clock::now() - g_start_time;
-    microseconds elapsed_usecs = duration_cast<microseconds>(duration);
-    return std::to_string(elapsed_usecs.count() / 1'000'000.0);
+    return std::to_string(log_timestamp());
+}
+
+// Longest log line. Longer messages are truncated.
+static constexpr size_t MAX_LINE_LENGTH = 256;
+
+int log_prefix(char* buffer, size_t size, uint64_t timestamp, int level, unsigned thread,
+               const char* file, int line, const char* function) {
+    // Raw nanoseconds and thread index, which are much cheaper than formatting times
+    // and thread IDs
+    int length = snprintf(buffer, size, "%llu %s %u %s:%d:%s() - ", (unsigned long long)timestamp,
+                          LEVEL_NAMES[level], thread, file, line, function);
+    return std::min<int>(length, size - 1);
+}
+
+void log_write(int level, const char* file, int line, const char* function, const char* format,
+               ...) {
+    if (level <= LOG_LEVEL_WARNING)
+        flight_record_event(format, file, level);
+
+    char buffer[MAX_LINE_LENGTH];
+
+    int length = log_prefix(buffer, sizeof(buffer), log_timestamp(), level, log_thread_index(),
+                            file, line, function);
+
+    va_list args;
+    va_start(args, format);
+    length += vsnprintf(buffer + length, sizeof(buffer) - length, format, args);
+    va_end(args);
+
+    // Written in one go so that lines from different threads don't get mixed up
+    length = std::min<int>(length, sizeof(buffer) - 2);
+    buffer[length++] = '\n';
+    fwrite(buffer, 1, length, stderr);
 }
@@ -1,38 +1,167 @@
-// Provides a macro debug() for debugging output. If DEBUG is defined, debug() will print to stderr.
-// Otherwise, debug() will do nothing, and will be optimized out by the compiler and therefore have
-// no runtime overhead.
+#ifndef DEBUG_H
+#define DEBUG_H
+
+// Provides leveled logging macros: log_error(), log_warning(), log_info() and
+// log_debug(), plus debug() which is the same as log_debug(). They take printf style
+// arguments and print a line to stderr with the time, level, thread, file, line and
+// function. Enabled calls format into a buffer on the stack, so never allocate memory,
+// and the file name is reduced to just its basename at compile time.
+//
+// Each source file belongs to a log module, named by defining LOG_MODULE_NAME before
+// including this file. Files in the same area can share a module name:
+//   #define LOG_MODULE_NAME "storage"
+//   #include "../util/debug.h"
+// Files without a module use the "default" module.
 //
-// To use this, define DEBUG before including this file. For example:
-//   #define DEBUG
-//   #include "debug.h"
+// Each module has a level that can be changed at run time, from the UI or a config
+// file, using log_set_level() or log_configure(). A call above its module's level
+// costs a single relaxed atomic load and a predictable branch. Modules start at
+// LOG_DEFAULT_LEVEL, or at LOG_LEVEL_DEBUG if the file defines DEBUG as it used to.
+//
+// Calls above LOG_LEVEL are removed at compile time, though their arguments are still
+// checked by the compiler. LOG_LEVEL includes everything unless the build or the file
+// defines it lower.
 
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
-#include <filesystem>
+#include <string>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_DEFAULT_LEVEL
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_WARNING
+#endif
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// A named group of source files whose log level can be set at run time. Modules
+// register themselves when constructed, so must have static storage duration.
+struct LogModule {
+    LogModule(const char* module_name, int initial_level);
+
+    LogModule(const LogModule&) = delete;
+    LogModule& operator=(const LogModule&) = delete;
+
+    bool enabled(int level) const {
+        return level <= current_level.load(std::memory_order_relaxed);
+    }
+
+    const char* name;
+    std::atomic<int> current_level;
+    LogModule* next = nullptr;
+};
+
+// For iterating over the registered modules, for example to list them in the UI.
+// Several modules can have the same name.
+LogModule* log_first_module();
+
+// Sets the level of all modules with the name, or of all modules if name is "*".
+// Modules registered later with the name start at the level too. Returns false if
+// there is no such module yet.
+bool log_set_level(const char* name, int level);
+
+// Level from its name, such as "warning", ignoring case. Returns -1 if not a level.
+int log_level_from_name(const char* name);
 
+// Sets levels from text like "storage=info clock=debug", with entries separated by
+// spaces, commas or new lines. Lines starting with # are comments. "*" sets all
+// modules. Returns false if any entry isn't valid, or names a module that isn't
+// registered yet, though the valid ones are applied.
+bool log_configure(const char* settings);
+
+// Same as log_configure() but with the contents of a file. Returns false if the file
+// can't be read.
+bool log_load_config(const std::string& path);
+
+// The module of files that don't define LOG_MODULE_NAME
+extern LogModule g_default_log_module;
+
+#ifdef LOG_MODULE_NAME
 #ifdef DEBUG
-#define DEBUG_TEST 1
+static LogModule log_module(LOG_MODULE_NAME, LOG_LEVEL_DEBUG);
 #else
-#define DEBUG_TEST 0
+static LogModule log_module(LOG_MODULE_NAME, LOG_DEFAULT_LEVEL);
+#endif
+#define LOG_CURRENT_MODULE log_module
+#else
+#define LOG_CURRENT_MODULE g_default_log_module
 #endif
 
-// Returns the current thread's ID as a string.
+// Returns the current thread's index as a string.
 std::string thread_id();
 
-// Returns the current thread's ID as a string, but only the last 6 characters.
+// Same as thread_id(), which is already short.
 std::string short_thread_id();
 
-// Returns as a string the time elapsed in microseconds since application started.
+// Returns as a string the time elapsed in nanoseconds since application started.
 std::string time_str();
 
-// See https://stackoverflow.com/questions/1644868/define-macro-for-debug-printing-in-c#1644898
-// for further explanation of this complicated macro. Also, to successfully get just the filename
-// from __FILE__ and pass it as part of varargs to fprintf, we need to first convert it to a string literal.
-#define debug(fmt, ...)                                                                \
-    do {                                                                               \
-        if (DEBUG_TEST) {                                                              \
-            const char* filename = std::filesystem::path(__FILE__).filename().c_str(); \
-            fprintf(stderr, "%s DEBUG %s %s:%d:%s() - " fmt "\n",                      \
-                    time_str().c_str(), short_thread_id().c_str(), filename,           \
-                    __LINE__, __func__, ##__VA_ARGS__);                                \
-        }                                                                              \
+// When the application started
+extern const std::chrono::steady_clock::time_point g_start_time;
+
+// Source of thread indexes. Use log_thread_index() instead.
+extern std::atomic<unsigned> g_next_thread_index;
+
+// Small number identifying the calling thread in log lines, 0 for the first thread
+// that logs. Assigned on first use and then cached, so is cheap.
+inline unsigned log_thread_index() {
+    static thread_local int index = -1;
+    if (index < 0)
+        index = g_next_thread_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+// Returns the part of path after the last slash. constexpr so that the log macros can
+// do this at compile time.
+constexpr const char* log_basename(const char* path) {
+    const char* basename = path;
+    for (const char* c = path; *c != '\0'; ++c) {
+        if (*c == '/' || *c == '\\')
+            basename = c + 1;
+    }
+    return basename;
+}
+
+// Nanoseconds since the application started, as used for log lines
+inline uint64_t log_timestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                g_start_time)
+        .count();
+}
+
+// Formats the start of a log line, up to the message, into buffer. Returns the length,
+// which is less than size. Shared with the asynchronous logger.
+int log_prefix(char* buffer, size_t size, uint64_t timestamp, int level, unsigned thread,
+               const char* file, int line, const char* function);
+
+// Writes a log line. Used by the macros below rather than called directly.
+void log_write(int level, const char* file, int line, const char* function, const char* format,
+               ...) __attribute__((format(printf, 5, 6)));
+
+#define log_at(level, fmt, ...)                                                     \
+    do {                                                                            \
+        if constexpr ((level) <= LOG_LEVEL) {                                       \
+            if (LOG_CURRENT_MODULE.enabled(level)) {                                \
+                static constexpr const char* log_file = log_basename(__FILE__);     \
+                log_write(level, log_file, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+            }                                                                       \
+        }                                                                           \
     } while (0)
+
+#define log_error(fmt, ...) log_at(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define log_warning(fmt, ...) log_at(LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
+#define log_info(fmt, ...) log_at(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define log_debug(fmt, ...) log_at(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define debug(fmt, ...) log_at(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#endif  // DEBUG_H
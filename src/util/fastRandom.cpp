@@ -1,16 +1,121 @@
 #include "fastRandom.h"
 
-static unsigned int g_seed;
-         
-void fast_srand(int seed) {
-    g_seed = seed;
+// The fill functions work on a local copy of the generator. Otherwise the compiler
+// has to assume that writing to values could change the state, and reloads it for
+// every value.
+
+void FastRandom::fill(uint32_t* values, size_t count) {
+    FastRandom local = *this;
+    for (size_t i = 0; i < count; ++i)
+        values[i] = local.next();
+    *this = local;
+}
+
+void FastRandom::fill_range(int32_t* values, size_t count, int32_t min, int32_t max) {
+    uint32_t span = (uint32_t)max - (uint32_t)min + 1;
+    if (span == 0) {
+        fill(reinterpret_cast<uint32_t*>(values), count);
+        return;
+    }
+    FastRandom local = *this;
+    for (size_t i = 0; i < count; ++i)
+        values[i] = (int32_t)((uint32_t)min + local.below(span));
+    *this = local;
+}
+
+void FastRandom::fill_uniform(float* values, size_t count, float min, float max) {
+    FastRandom local = *this;
+    float scale = (max - min) * 0x1p-24f;
+    float highest = std::nextafter(max, min);
+    for (size_t i = 0; i < count; ++i)
+        values[i] = std::min(min + (local.next() >> 8) * scale, highest);
+    *this = local;
+}
+
+void FastRandomLanes::seed(uint64_t seed_value) {
+    FastRandom seeder(seed_value);
+    for (int i = 0; i < LANES; ++i) {
+        s0[i] = seeder.next();
+        s1[i] = seeder.next();
+        s2[i] = seeder.next();
+        s3[i] = seeder.next();
+    }
+    pink[0] = pink[1] = pink[2] = 0.0f;
+}
+
+void FastRandomLanes::fill(uint32_t* values, size_t count) {
+    uint32_t block[LANES];
+    for (size_t i = 0; i < count; i += LANES) {
+        next_block(block);
+        for (size_t lane = 0; lane < LANES && i + lane < count; ++lane)
+            values[i + lane] = block[lane];
+    }
 }
 
-int fast_rand() {
-    g_seed = (214013 * g_seed + 2531011);
-    return (g_seed >> 16) & 0x7FFF;
+void FastRandomLanes::fill_uniform(float* values, size_t count, float min, float max) {
+    float scale = (max - min) * 0x1p-24f;
+    float highest = std::nextafter(max, min);
+    uint32_t block[LANES];
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        next_block(block);
+        for (int lane = 0; lane < LANES; ++lane)
+            values[i + lane] = std::min(min + (block[lane] >> 8) * scale, highest);
+    }
+    if (i < count) {
+        next_block(block);
+        for (int lane = 0; i < count; ++i, ++lane)
+            values[i] = std::min(min + (block[lane] >> 8) * scale, highest);
+    }
 }
 
-int fast_rand(int min, int max) {
-    return fast_rand() % (max - min + 1) + min;
+// Irwin-Hall: each 32 bit value gives two 16 bit uniform values, and the sum of four
+// of them has a mean of 4 * 65535 / 2 and a standard deviation of about
+// 65536 * sqrt(4 / 12)
+static constexpr float GAUSSIAN_MEAN = 2.0f * 65535.0f;
+static constexpr float GAUSSIAN_SCALE = 1.0f / 37837.23f;
+
+void FastRandomLanes::fill_gaussian(float* values, size_t count, float mean, float deviation) {
+    float scale = deviation * GAUSSIAN_SCALE;
+    uint32_t first[LANES];
+    uint32_t second[LANES];
+    float block[LANES];
+    for (size_t i = 0; i < count; i += LANES) {
+        next_block(first);
+        next_block(second);
+        for (int lane = 0; lane < LANES; ++lane) {
+            uint32_t sum = (first[lane] & 0xFFFF) + (first[lane] >> 16) +
+                           (second[lane] & 0xFFFF) + (second[lane] >> 16);
+            block[lane] = mean + ((float)sum - GAUSSIAN_MEAN) * scale;
+        }
+        for (size_t lane = 0; lane < LANES && i + lane < count; ++lane)
+            values[i + lane] = block[lane];
+    }
+}
+
+// Scales the filter output so it mostly stays between -1 and 1
+static constexpr float PINK_GAIN = 0.15f;
+
+void FastRandomLanes::fill_pink(float* values, size_t count) {
+    fill_uniform(values, count, -1.0f, 1.0f);
+
+    // Paul Kellet's economy filter, which is within 0.05 dB of -3 dB per octave above
+    // 9 Hz at 44.1 kHz. The filter is sequential, but only a few multiplies per value.
+    float b0 = pink[0];
+    float b1 = pink[1];
+    float b2 = pink[2];
+    for (size_t i = 0; i < count; ++i) {
+        float white = values[i];
+        b0 = 0.99765f * b0 + white * 0.0990460f;
+        b1 = 0.96300f * b1 + white * 0.2965164f;
+        b2 = 0.57000f * b2 + white * 1.0526913f;
+        values[i] = (b0 + b1 + b2 + white * 0.1848f) * PINK_GAIN;
+    }
+    pink[0] = b0;
+    pink[1] = b1;
+    pink[2] = b2;
+}
+
+void fast_srand(int seed) {
+    default_random().seed((uint32_t)seed);
 }
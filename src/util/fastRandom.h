@@ -1,18 +1,245 @@
 #ifndef FASTRANDOM_H
 #define FASTRANDOM_H
 
-// fastRandom provides a random number generator based on the original implementation.
-// This implementation is known to not be truly random. But for many cases where speed
-// is more important than true randomness, this implementation is sufficient.
+// fastRandom provides fast pseudo-random number generation. Not suitable for anything
+// security related, but the quality is more than good enough for generative music.
+//
+// FastRandom is a generator with its own state, using xoshiro128** which only needs
+// 32 bit operations so is fast on the microcontroller too. Each thread that needs
+// random numbers should use its own generator, such as the one from default_random().
+//
+// FastRandomLanes runs several generators side by side, laid out so the compiler can
+// vectorize them, for filling buffers of noise at audio rate.
+//
+// StepRandom is stateless instead. Its values are computed directly from a seed, a
+// stream and a step number, so that generative playback gives the same values for a
+// step however it got there, such as after locating or looping.
+//
+// fast_srand() and fast_rand() are the original interface. They now use the calling
+// thread's default_random() generator, so the clock and UI threads no longer race.
 
-// Used to seed the generator. Not necessary to call if it is okay to get same 
-// sequence of random values          
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+class FastRandom {
+   public:
+    static inline constexpr uint64_t DEFAULT_SEED = 0x853C49E6748FEA9Bull;
+
+    // constexpr so that the default generators need no run-time initialization
+    constexpr explicit FastRandom(uint64_t seed_value = DEFAULT_SEED) {
+        seed(seed_value);
+    }
+
+    // Any seed, including 0, gives a good starting state
+    constexpr void seed(uint64_t seed_value) {
+        uint64_t first = split_mix(seed_value);
+        uint64_t second = split_mix(seed_value);
+        state[0] = (uint32_t)first;
+        state[1] = (uint32_t)(first >> 32);
+        state[2] = (uint32_t)second;
+        state[3] = (uint32_t)(second >> 32);
+    }
+
+    // Returns a pseudo-random 32 bit value
+    uint32_t next() {
+        uint32_t result = rotate_left(state[1] * 5, 7) * 9;
+        uint32_t shifted = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotate_left(state[3], 11);
+        return result;
+    }
+
+    // Returns a value from 0 to bound - 1, without bias. Uses Lemire's multiply-shift
+    // method, which only needs a division in the rare case that a value is rejected.
+    uint32_t below(uint32_t bound) {
+        uint64_t product = (uint64_t)next() * bound;
+        uint32_t low = (uint32_t)product;
+        if (low < bound) {
+            uint32_t threshold = -bound % bound;
+            while (low < threshold) {
+                product = (uint64_t)next() * bound;
+                low = (uint32_t)product;
+            }
+        }
+        return (uint32_t)(product >> 32);
+    }
+
+    // Returns a value from min to max inclusive, for any range
+    int32_t range(int32_t min, int32_t max) {
+        uint32_t span = (uint32_t)max - (uint32_t)min + 1;
+        if (span == 0)
+            return (int32_t)next();
+        return (int32_t)((uint32_t)min + below(span));
+    }
+
+    // Returns a value from 0 up to but not including 1, with 24 bits of precision
+    float uniform() {
+        return (next() >> 8) * 0x1p-24f;
+    }
+
+    // Returns a value from min up to but not including max, which must be above min
+    float uniform(float min, float max) {
+        // Rounding can give max itself when the range is large compared to its spacing
+        return std::min(min + uniform() * (max - min), std::nextafter(max, min));
+    }
+
+    // Fill arrays with random values in one call
+    void fill(uint32_t* values, size_t count);
+    void fill_range(int32_t* values, size_t count, int32_t min, int32_t max);
+    void fill_uniform(float* values, size_t count, float min = 0.0f, float max = 1.0f);
+
+    // So can be used with the distributions in <random>
+    using result_type = uint32_t;
+    static constexpr result_type min() {
+        return 0;
+    }
+    static constexpr result_type max() {
+        return UINT32_MAX;
+    }
+    result_type operator()() {
+        return next();
+    }
+
+   private:
+    friend class FastRandomLanes;
+
+    // splitmix64, to spread the bits of the seed over the whole state
+    static constexpr uint64_t split_mix(uint64_t& value) {
+        uint64_t z = (value += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    static constexpr uint32_t rotate_left(uint32_t value, int bits) {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    uint32_t state[4] = {};
+};
+
+class FastRandomLanes {
+   public:
+    // Enough lanes to fill 256 bit vector registers
+    static inline constexpr int LANES = 8;
+
+    explicit FastRandomLanes(uint64_t seed_value = FastRandom::DEFAULT_SEED) {
+        seed(seed_value);
+    }
+
+    // Each lane gets its own state, from a FastRandom with the seed
+    void seed(uint64_t seed_value);
+
+    void fill(uint32_t* values, size_t count);
+
+    // Values from min up to but not including max, by default 0 to 1 like
+    // FastRandom::fill_uniform(). For white noise use -1 to 1.
+    void fill_uniform(float* values, size_t count, float min = 0.0f, float max = 1.0f);
+
+    // Approximately normally distributed values, as the sum of four uniform values.
+    // Much cheaper than exact methods, but never more than 3.46 standard deviations
+    // from the mean.
+    void fill_gaussian(float* values, size_t count, float mean = 0.0f, float deviation = 1.0f);
+
+    // Pink noise, mostly between -1 and 1. Filters white noise with the filter state
+    // kept between calls, so successive buffers join up.
+    void fill_pink(float* values, size_t count);
+
+   private:
+    // Produces the next value of each lane. block is local to the caller, so the
+    // compiler knows it doesn't alias the state and can vectorize.
+    void next_block(uint32_t (&block)[LANES]) {
+        for (int i = 0; i < LANES; ++i) {
+            block[i] = FastRandom::rotate_left(s1[i] * 5, 7) * 9;
+            uint32_t shifted = s1[i] << 9;
+            s2[i] ^= s0[i];
+            s3[i] ^= s1[i];
+            s1[i] ^= s2[i];
+            s0[i] ^= s3[i];
+            s2[i] ^= shifted;
+            s3[i] = FastRandom::rotate_left(s3[i], 11);
+        }
+    }
+
+    // State of each lane, as separate arrays so each is a vector
+    alignas(32) uint32_t s0[LANES];
+    alignas(32) uint32_t s1[LANES];
+    alignas(32) uint32_t s2[LANES];
+    alignas(32) uint32_t s3[LANES];
+
+    // Pink noise filter
+    float pink[3] = {};
+};
+
+class StepRandom {
+   public:
+    // The stream separates the values of things sharing a seed, such as tracks
+    constexpr explicit StepRandom(uint32_t seed = 0, uint16_t stream = 0)
+        : key(seed), stream_id(stream) {}
+
+    // Value n of the step. Uses the Philox2x32-10 counter-based generator, with the
+    // step, stream and n as the counter and the seed as the key.
+    uint32_t value(uint32_t step, uint16_t n = 0) const {
+        uint32_t x0 = step;
+        uint32_t x1 = ((uint32_t)stream_id << 16) | n;
+        uint32_t round_key = key;
+        for (int round = 0; round < 10; ++round) {
+            uint64_t product = (uint64_t)0xD256D193u * x0;
+            x0 = (uint32_t)(product >> 32) ^ round_key ^ x1;
+            x1 = (uint32_t)product;
+            round_key += 0x9E3779B9u;
+        }
+        return x0;
+    }
+
+    // Value from min to max inclusive. Since a value can't be redrawn there is a bias
+    // of up to range size / 2^32, which is negligible for the ranges used in music.
+    int32_t range(uint32_t step, int32_t min, int32_t max, uint16_t n = 0) const {
+        uint32_t span = (uint32_t)max - (uint32_t)min + 1;
+        if (span == 0)
+            return (int32_t)value(step, n);
+        return (int32_t)((uint32_t)min + (uint32_t)(((uint64_t)value(step, n) * span) >> 32));
+    }
+
+    // Value from 0 up to but not including 1
+    float uniform(uint32_t step, uint16_t n = 0) const {
+        return (value(step, n) >> 8) * 0x1p-24f;
+    }
+
+    // Whether something with the probability, such as a Step, happens at the step
+    bool chance(uint32_t step, int percent, uint16_t n = 0) const {
+        return range(step, 0, 99, n) < percent;
+    }
+
+   private:
+    uint32_t key;
+    uint16_t stream_id;
+};
+
+// The calling thread's own generator
+inline FastRandom& default_random() {
+    static thread_local FastRandom generator;
+    return generator;
+}
+
+// Used to seed the calling thread's generator. Not necessary to call if it is okay to
+// get same sequence of random values.
 void fast_srand(int seed);
 
 // Returns a pseudo-random integer between 0 and 32767.
-int fast_rand();
+inline int fast_rand() {
+    return default_random().next() >> 17;
+}
 
-// Returns a pseudo-random integer between min and max, up to 32767.
-int fast_rand(int min, int max);
+// Returns a pseudo-random integer between min and max inclusive, without bias.
+inline int fast_rand(int min, int max) {
+    return default_random().range(min, max);
+}
 
 #endif // FASTRANDOM_H
@@ -0,0 +1,301 @@
+#include "flightRecorder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+static_assert((FLIGHT_RECORDER_CAPACITY & (FLIGHT_RECORDER_CAPACITY - 1)) == 0,
+              "FLIGHT_RECORDER_CAPACITY must be a power of two");
+
+struct FlightEvent {
+    // Index of the event plus one once it is completely written, or 0 while it is
+    // being written, so a dump can skip events that are being overwritten
+    std::atomic<uint64_t> sequence{0};
+    uint64_t timestamp = 0;
+    const char* name = nullptr;
+    const char* category = nullptr;
+    int64_t value = 0;
+    unsigned thread = 0;
+};
+
+// Statically allocated, so there is nothing to set up and a crash can't be caused by
+// a missing buffer
+static FlightEvent events[FLIGHT_RECORDER_CAPACITY];
+static std::atomic<uint64_t> next_event{0};
+
+void flight_record_event(const char* name, const char* category, int64_t value) {
+    uint64_t index = next_event.fetch_add(1, std::memory_order_relaxed);
+    FlightEvent& event = events[index & (FLIGHT_RECORDER_CAPACITY - 1)];
+
+    event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.timestamp = log_timestamp();
+    event.name = name;
+    event.category = category;
+    event.value = value;
+    event.thread = log_thread_index();
+    event.sequence.store(index + 1, std::memory_order_release);
+}
+
+uint64_t flight_recorder_event_count() {
+    return next_event.load(std::memory_order_relaxed);
+}
+
+// Line formatting that doesn't use printf, which isn't safe in a signal handler
+static size_t append(char* buffer, size_t size, size_t length, const char* text) {
+    while (*text && length < size)
+        buffer[length++] = *text++;
+    return length;
+}
+
+static size_t append_number(char* buffer, size_t size, size_t length, uint64_t number,
+                            bool negative = false) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number);
+    if (negative)
+        digits[count++] = '-';
+    while (count && length < size)
+        buffer[length++] = digits[--count];
+    return length;
+}
+
+static constexpr size_t MAX_LINE_LENGTH = 256;
+
+// Calls write_line with each event that is still intact, oldest first, formatted as
+// "timestamp thread category value name"
+template <typename WriteLine>
+static void for_each_line(WriteLine&& write_line) {
+    char line[MAX_LINE_LENGTH];
+    uint64_t end = next_event.load(std::memory_order_acquire);
+    uint64_t start = end > FLIGHT_RECORDER_CAPACITY ? end - FLIGHT_RECORDER_CAPACITY : 0;
+
+    size_t length = append(line, sizeof(line), 0, "Flight recorder: ");
+    length = append_number(line, sizeof(line), length, end - start);
+    length = append(line, sizeof(line), length, " events at ");
+    length = append_number(line, sizeof(line), length, log_timestamp());
+    length = append(line, sizeof(line), length, "\n");
+    write_line(line, length);
+
+    for (uint64_t index = start; index < end; ++index) {
+        const FlightEvent& event = events[index & (FLIGHT_RECORDER_CAPACITY - 1)];
+        uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+        if (sequence != index + 1)
+            continue;
+        FlightEvent copy;
+        copy.timestamp = event.timestamp;
+        copy.name = event.name;
+        copy.category = event.category;
+        copy.value = event.value;
+        copy.thread = event.thread;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        length = append_number(line, sizeof(line) - 1, 0, copy.timestamp);
+        length = append(line, sizeof(line) - 1, length, " ");
+        length = append_number(line, sizeof(line) - 1, length, copy.thread);
+        length = append(line, sizeof(line) - 1, length, " ");
+        length = append(line, sizeof(line) - 1, length, copy.category);
+        length = append(line, sizeof(line) - 1, length, " ");
+        length = append_number(line, sizeof(line) - 1, length,
+                               copy.value < 0 ? 0 - (uint64_t)copy.value : (uint64_t)copy.value,
+                               copy.value < 0);
+        length = append(line, sizeof(line) - 1, length, " ");
+        length = append(line, sizeof(line) - 1, length, copy.name);
+        line[length++] = '\n';
+        write_line(line, length);
+    }
+}
+
+#ifdef __unix__
+static void write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written <= 0)
+            return;
+        data += written;
+        length -= written;
+    }
+}
+
+void flight_recorder_dump(int fd) {
+    for_each_line([fd](const char* line, size_t length) { write_all(fd, line, length); });
+}
+#endif
+
+bool flight_recorder_write(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        log_error("Could not open %s", path.c_str());
+        return false;
+    }
+    bool ok = true;
+    for_each_line([&](const char* line, size_t length) {
+        ok &= fwrite(line, 1, length, file) == length;
+    });
+    ok &= fclose(file) == 0;
+    return ok;
+}
+
+// Where the crash handler and watchdog dump to, besides stderr. Kept in a fixed
+// buffer so the signal handler doesn't touch the heap.
+static char dump_path[256];
+
+#ifdef __linux__
+static const int CRASH_SIGNALS[] = {SIGSEGV, SIGABRT, SIGBUS, SIGILL, SIGFPE};
+
+// So a stack overflow can still be handled. The main thread's is static, other
+// threads allocate theirs.
+static constexpr size_t ALTERNATE_STACK_SIZE = 64 * 1024;
+static char alternate_stack[ALTERNATE_STACK_SIZE];
+
+// Alternate stack of a thread, taken down before it is freed when the thread exits
+struct ThreadAlternateStack {
+    std::unique_ptr<char[]> memory;
+
+    ~ThreadAlternateStack() {
+        if (!memory)
+            return;
+        stack_t stack{};
+        stack.ss_flags = SS_DISABLE;
+        sigaltstack(&stack, nullptr);
+    }
+};
+
+static void crash_handler(int signal_number) {
+    static volatile sig_atomic_t handling = 0;
+    if (!handling) {
+        handling = 1;
+
+        char line[64];
+        size_t length = append(line, sizeof(line) - 1, 0, "Caught signal ");
+        length = append_number(line, sizeof(line) - 1, length, signal_number);
+        line[length++] = '\n';
+        write_all(STDERR_FILENO, line, length);
+
+        flight_recorder_dump(STDERR_FILENO);
+        if (dump_path[0]) {
+            int fd = open(dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                flight_recorder_dump(fd);
+                close(fd);
+            }
+        }
+    }
+
+    // The handler was reset to the default, so this crashes as it would have
+    raise(signal_number);
+}
+
+bool flight_recorder_install_crash_handler(const char* path) {
+    if (path)
+        snprintf(dump_path, sizeof(dump_path), "%s", path);
+
+    // Only applies to the calling thread, normally the main thread. Other threads call
+    // flight_recorder_install_thread_stack().
+    stack_t stack{};
+    stack.ss_sp = alternate_stack;
+    stack.ss_size = sizeof(alternate_stack);
+    sigaltstack(&stack, nullptr);
+
+    struct sigaction action {};
+    action.sa_handler = crash_handler;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    bool ok = true;
+    for (int signal_number : CRASH_SIGNALS)
+        ok &= sigaction(signal_number, &action, nullptr) == 0;
+    return ok;
+}
+
+bool flight_recorder_install_thread_stack() {
+    // Nothing to do if the thread already has one
+    stack_t current{};
+    if (sigaltstack(nullptr, &current) != 0)
+        return false;
+    if (!(current.ss_flags & SS_DISABLE))
+        return true;
+
+    static thread_local ThreadAlternateStack thread_stack;
+    thread_stack.memory.reset(new char[ALTERNATE_STACK_SIZE]);
+    stack_t stack{};
+    stack.ss_sp = thread_stack.memory.get();
+    stack.ss_size = ALTERNATE_STACK_SIZE;
+    return sigaltstack(&stack, nullptr) == 0;
+}
+#else
+bool flight_recorder_install_crash_handler(const char* path) {
+    if (path)
+        snprintf(dump_path, sizeof(dump_path), "%s", path);
+    return false;
+}
+
+bool flight_recorder_install_thread_stack() {
+    return false;
+}
+#endif
+
+static std::atomic<uint64_t> last_kick{0};
+static std::mutex watchdog_mutex;
+static std::condition_variable watchdog_wake;
+static std::thread watchdog;
+static bool watchdog_stopping = false;
+
+void flight_watchdog_kick() {
+    last_kick.store(log_timestamp(), std::memory_order_relaxed);
+}
+
+static void watchdog_loop(std::chrono::milliseconds timeout) {
+    flight_recorder_install_thread_stack();
+    const uint64_t timeout_ns = std::chrono::nanoseconds(timeout).count();
+    bool triggered = false;
+
+    std::unique_lock<std::mutex> lock(watchdog_mutex);
+    while (!watchdog_wake.wait_for(lock, timeout / 4, [] { return watchdog_stopping; })) {
+        uint64_t since_kick = log_timestamp() - last_kick.load(std::memory_order_relaxed);
+        if (since_kick <= timeout_ns) {
+            triggered = false;
+        } else if (!triggered) {
+            triggered = true;
+            log_error("Watchdog not kicked for %llu ms", (unsigned long long)(since_kick / 1000000));
+            if (!dump_path[0] || !flight_recorder_write(dump_path)) {
+#ifdef __unix__
+                flight_recorder_dump(STDERR_FILENO);
+#endif
+            }
+        }
+    }
+}
+
+void flight_watchdog_start(std::chrono::milliseconds timeout) {
+    flight_watchdog_stop();
+    flight_watchdog_kick();
+    watchdog_stopping = false;
+    // Runs at normal priority, since it has to run even when the thread it watches is
+    // stuck using the CPU
+    watchdog = std::thread(watchdog_loop, timeout);
+}
+
+void flight_watchdog_stop() {
+    if (!watchdog.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(watchdog_mutex);
+        watchdog_stopping = true;
+    }
+    watchdog_wake.notify_all();
+    watchdog.join();
+}
@@ -0,0 +1,74 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+// The flight recorder keeps the most recent events in a fixed size ring in RAM, so
+// that when something goes wrong during a performance there is a history of what led
+// up to it. Unlike tracing it is always on. Recording an event takes a few
+// nanoseconds and never blocks or allocates, so it can be used from the clock thread.
+//
+// Warnings and errors logged with debug.h or asyncLog.h are recorded automatically,
+// with the format string as the name and the level as the value. Other events, such
+// as transport changes and how late each clock tick was, are recorded explicitly:
+//
+//   flight_record("tick late ns", lateness.count());
+//
+// The events are dumped on request by flight_recorder_write(), when the watchdog
+// isn't kicked in time, and on Linux when the program crashes or aborts, once
+// flight_recorder_install_crash_handler() has been called. Names and categories must
+// be string literals, since only the pointers are kept.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "debug.h"
+
+// Events kept. Must be a power of two.
+inline constexpr size_t FLIGHT_RECORDER_CAPACITY = 2048;
+
+// Records an event. Used by the macro rather than called directly.
+void flight_record_event(const char* name, const char* category, int64_t value = 0);
+
+// Number of events recorded since the program started, including ones since
+// overwritten
+uint64_t flight_recorder_event_count();
+
+#ifdef __unix__
+// Writes the events to a file descriptor as text, oldest first. Only uses async
+// signal safe functions, so can be called from a signal handler.
+void flight_recorder_dump(int fd);
+#endif
+
+// Writes the events to a file as text, oldest first. Returns false if the file can't
+// be written.
+bool flight_recorder_write(const std::string& path);
+
+// On Linux, dumps the events to stderr and to the file at path, if not null, when the
+// program gets SIGSEGV, SIGABRT, SIGBUS, SIGILL or SIGFPE, and then lets the signal
+// take its default action. Returns false if not supported or the handlers couldn't be
+// installed.
+bool flight_recorder_install_crash_handler(const char* path = nullptr);
+
+// Gives the calling thread its own stack for the crash handler, so that a stack
+// overflow on that thread can still be dumped. The stack is freed when the thread
+// exits. flight_recorder_install_crash_handler() only does this for the thread that
+// calls it, so other threads call this when they start. async_log_register_thread()
+// and trace_thread_name() call it too. Returns false if not supported.
+bool flight_recorder_install_thread_stack();
+
+// Starts a thread that dumps the events, to the crash handler's file or else to
+// stderr, if flight_watchdog_kick() isn't called for longer than timeout. Dumps once
+// each time it is triggered. The timeout must be longer than the watched thread ever
+// waits between kicks. Clock kicks at least every 50 ms, whatever the tempo.
+void flight_watchdog_start(std::chrono::milliseconds timeout);
+
+// Stops the watchdog thread
+void flight_watchdog_stop();
+
+// Called regularly by the thread being watched, such as the clock thread each tick
+void flight_watchdog_kick();
+
+#define flight_record(name, value) flight_record_event(name, log_basename(__FILE__), value)
+
+#endif  // FLIGHT_RECORDER_H
@@ -0,0 +1,114 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include "flightRecorder.h"
+#include "json.hpp"
+
+struct TraceEvent {
+    // Set last, so a reader that sees the name sees the whole event
+    std::atomic<const char*> name{nullptr};
+    const char* category;
+    uint64_t timestamp;
+    uint64_t duration;
+    int64_t value;
+    unsigned thread;
+    char phase;
+};
+
+// Threads beyond this many are traced without names
+static constexpr unsigned MAX_NAMED_THREADS = 64;
+
+std::atomic<bool> g_trace_recording{false};
+
+static std::unique_ptr<TraceEvent[]> events;
+static std::atomic<size_t> next_event{0};
+static std::atomic<const char*> thread_names[MAX_NAMED_THREADS];
+
+void trace_start() {
+    g_trace_recording = false;
+    if (!events)
+        events.reset(new TraceEvent[TRACE_CAPACITY]);
+    for (size_t i = 0; i < TRACE_CAPACITY; ++i)
+        events[i].name.store(nullptr, std::memory_order_relaxed);
+    next_event = 0;
+    g_trace_recording = true;
+}
+
+void trace_stop() {
+    g_trace_recording = false;
+}
+
+size_t trace_event_count() {
+    return next_event.load(std::memory_order_relaxed);
+}
+
+void trace_record(char phase, const char* name, const char* category, uint64_t timestamp,
+                  uint64_t duration, int64_t value) {
+    size_t index = next_event.fetch_add(1, std::memory_order_relaxed);
+    if (index >= TRACE_CAPACITY)
+        return;
+
+    TraceEvent& event = events[index];
+    event.category = category;
+    event.timestamp = timestamp;
+    event.duration = duration;
+    event.value = value;
+    event.thread = log_thread_index();
+    event.phase = phase;
+    event.name.store(name, std::memory_order_release);
+}
+
+void trace_set_thread_name(const char* name) {
+    flight_recorder_install_thread_stack();
+
+    unsigned thread = log_thread_index();
+    if (thread < MAX_NAMED_THREADS)
+        thread_names[thread].store(name, std::memory_order_relaxed);
+}
+
+bool trace_write_json(const std::string& path) {
+    using json = nlohmann::json;
+
+    json trace_events = json::array();
+    for (unsigned thread = 0; thread < MAX_NAMED_THREADS; ++thread) {
+        const char* name = thread_names[thread].load(std::memory_order_relaxed);
+        if (name) {
+            trace_events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1},
+                                    {"tid", thread}, {"args", {{"name", name}}}});
+        }
+    }
+
+    size_t count = std::min(trace_event_count(), TRACE_CAPACITY);
+    for (size_t i = 0; events && i < count; ++i) {
+        const TraceEvent& event = events[i];
+        const char* name = event.name.load(std::memory_order_acquire);
+        if (!name)
+            continue;
+
+        // Times are in microseconds
+        json entry = {{"name", name},
+                      {"cat", event.category},
+                      {"ph", std::string(1, event.phase)},
+                      {"ts", event.timestamp / 1000.0},
+                      {"pid", 1},
+                      {"tid", event.thread}};
+        if (event.phase == 'X')
+            entry["dur"] = event.duration / 1000.0;
+        else if (event.phase == 'i')
+            entry["s"] = "t";
+        else if (event.phase == 'C')
+            entry["args"] = {{"value", event.value}};
+        trace_events.push_back(std::move(entry));
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        log_error("Could not open %s", path.c_str());
+        return false;
+    }
+    file << json{{"traceEvents", trace_events}, {"displayTimeUnit", "ns"}}.dump();
+    return (bool)file;
+}
@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Tracing, for seeing how clock ticks, callbacks, UI updates and saving overlap in
+// time. Spans are timed scopes, instants mark a single point in time, and counters
+// track a value. Events are recorded into a fixed size lock-free buffer between
+// trace_start() and trace_stop(), and trace_write_json() then writes them in the
+// Chrome trace event format, which can be opened in Perfetto (ui.perfetto.dev) or
+// chrome://tracing.
+//
+// The macros compile to nothing unless TRACE is defined, which the SEQUENCER_TRACE
+// CMake option does. It is off by default. When compiled in but not recording, each
+// costs one relaxed atomic load. sequencer_sim records a trace when the
+// SEQUENCER_TRACE_FILE environment variable is set. Event names and categories must be string literals. The category is
+// the basename of the source file.
+//
+//   void Clock::loop() {
+//       trace_thread_name("clock");
+//       ...
+//       trace_scope("tick");
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "debug.h"
+
+// Most events recorded in one trace. Later events are dropped.
+inline constexpr size_t TRACE_CAPACITY = 1 << 16;
+
+extern std::atomic<bool> g_trace_recording;
+
+inline bool trace_is_recording() {
+    return g_trace_recording.load(std::memory_order_relaxed);
+}
+
+// Starts recording, discarding any events recorded before. Allocates the buffer the
+// first time. Should be called while nothing is being traced.
+void trace_start();
+
+void trace_stop();
+
+// Number of events recorded, including any that were dropped
+size_t trace_event_count();
+
+// Records an event. phase is as in the Chrome format: 'X' for a span, 'i' for an
+// instant and 'C' for a counter. Used by the macros rather than called directly.
+void trace_record(char phase, const char* name, const char* category, uint64_t timestamp,
+                  uint64_t duration = 0, int64_t value = 0);
+
+// Names the calling thread in the trace
+void trace_set_thread_name(const char* name);
+
+// Writes the recorded events as Chrome trace event JSON. Returns false if the file
+// can't be written.
+bool trace_write_json(const std::string& path);
+
+// Records a span from construction to destruction
+class TraceScope {
+   public:
+    TraceScope(const char* span_name, const char* span_category)
+        : name(span_name), category(span_category) {
+        if (trace_is_recording())
+            start = log_timestamp();
+    }
+
+    ~TraceScope() {
+        if (start != NOT_RECORDING)
+            trace_record('X', name, category, start, log_timestamp() - start);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+   private:
+    static inline constexpr uint64_t NOT_RECORDING = UINT64_MAX;
+
+    const char* name;
+    const char* category;
+    uint64_t start = NOT_RECORDING;
+};
+
+#ifdef TRACE
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define trace_scope(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, log_basename(__FILE__))
+
+#define trace_instant(name)                                                       \
+    do {                                                                          \
+        if (trace_is_recording())                                                 \
+            trace_record('i', name, log_basename(__FILE__), log_timestamp());     \
+    } while (0)
+
+#define trace_counter(name, value)                                                    \
+    do {                                                                              \
+        if (trace_is_recording())                                                     \
+            trace_record('C', name, log_basename(__FILE__), log_timestamp(), 0, value); \
+    } while (0)
+
+#define trace_thread_name(name) trace_set_thread_name(name)
+
+#else
+
+#define trace_scope(name) \
+    do {                  \
+    } while (0)
+#define trace_instant(name) \
+    do {                    \
+    } while (0)
+#define trace_counter(name, value) \
+    do {                           \
+    } while (0)
+#define trace_thread_name(name) \
+    do {                        \
+    } while (0)
+
+#endif  // TRACE
+
+#endif  // TRACE_H
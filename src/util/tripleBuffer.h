@@ -0,0 +1,72 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// TripleBuffer passes the latest version of an object from one writer thread to one
+// reader thread without either ever blocking. The writer fills in its own buffer and
+// publishes it. The reader always gets the most recently published buffer, complete,
+// and keeps using it until it asks for a newer one. Intermediate versions that the
+// reader never got to are simply skipped.
+//
+// Three buffers are needed: one being written, one being read, and the most recently
+// published one waiting for the reader. Publishing and reading just swap indexes
+// with a single atomic exchange.
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer {
+   public:
+    TripleBuffer() = default;
+
+    // All three buffers start out as copies of initial
+    explicit TripleBuffer(const T& initial) {
+        for (T& buffer : buffers)
+            buffer = initial;
+    }
+
+    // Writer thread. The buffer to fill in before calling publish(). After publishing,
+    // this is a different buffer that holds an older version.
+    T& write_buffer() {
+        return buffers[write_index];
+    }
+
+    // Writer thread. Makes the write buffer available to the reader.
+    void publish() {
+        uint8_t previous = middle.exchange(write_index | FRESH, std::memory_order_acq_rel);
+        write_index = previous & INDEX_MASK;
+    }
+
+    // Reader thread. Returns true if something was published since last read().
+    bool has_update() const {
+        return middle.load(std::memory_order_acquire) & FRESH;
+    }
+
+    // Reader thread. Returns the most recently published buffer. The reference stays
+    // valid, and unchanged, until the next call to read().
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            uint8_t previous = middle.exchange(read_index, std::memory_order_acq_rel);
+            read_index = previous & INDEX_MASK;
+        }
+        return buffers[read_index];
+    }
+
+   private:
+    static inline constexpr uint8_t INDEX_MASK = 0x03;
+    static inline constexpr uint8_t FRESH = 0x04;
+
+    T buffers[3];
+
+    // Index of the buffer between writer and reader, with FRESH set if the reader
+    // hasn't taken it yet
+    std::atomic<uint8_t> middle{2};
+
+    // Only accessed by the writer thread
+    uint8_t write_index = 0;
+
+    // Only accessed by the reader thread
+    uint8_t read_index = 1;
+};
+
+#endif  // TRIPLE_BUFFER_H